@@ -0,0 +1,94 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+LU factorization of a batch of independent matrices with pivoting over the
+diagonal blocks. All matrices have the same size and are stored one after
+the other in global memory.
+*/
+
+#include "lu_blocked_pvt_common.h"
+
+#if MEMORY_BANKS > 1
+#error "Only the blocked_pvt kernel supports multiple memory banks"
+#endif
+
+
+/**
+LU factorization kernel for a batch of matrices.
+Every matrix is factorized with the same block schedule as the gefa kernel
+of blocked_pvt. The matrices are interleaved per diagonal block: the step of
+a diagonal block is calculated for all matrices before the next diagonal
+block is processed. The steps of different matrices are independent, so the
+pipeline of a step does not have to drain before the step of the next matrix
+starts. The state of every matrix is kept in its own part of a and pvt.
+
+@param a The data array containing all matrices one after the other
+@param pvt Pivoting information of all matrices one after the other
+@param a_size the x and y size of a single matrix in blocks
+@param batch the number of matrices
+*/
+__attribute__((uses_global_work_offset(0)))
+__kernel
+void gefa(global DATA_TYPE* restrict a, global int* restrict pvt,
+		  uint a_size, uint batch) {
+	const ulong matrix_elements = (ulong) a_size * a_size * BLOCK_SIZE
+															* BLOCK_SIZE;
+
+	for (int diagonal_block=0; diagonal_block < a_size; diagonal_block++) {
+		// Every matrix only accesses its own part of a and pvt
+		#pragma ivdep array(a)
+		#pragma ivdep array(pvt)
+		for (uint matrix = 0; matrix < batch; matrix++) {
+			gefa_step(a + matrix * matrix_elements,
+					  pvt + (ulong) matrix * a_size * BLOCK_SIZE,
+					  diagonal_block, a_size, 0, a_size);
+		}
+	}
+}
+
+
+/**
+Solve kernel that solves the linear equations A*x = b for a batch of
+matrices using the LU factorizations calculated by the gefa kernel.
+
+@param a The data array containing all LU factorized matrices one after the
+		 other
+@param b The right-hand sides of all matrices one after the other. Will be
+		 overwritten with the solutions.
+@param pvt Pivoting information of all matrices calculated by gefa
+@param a_size the x and y size of a single matrix in blocks
+@param batch the number of matrices
+*/
+__attribute__((uses_global_work_offset(0)))
+__kernel
+void gesl(global DATA_TYPE* restrict a, global DATA_TYPE* restrict b,
+		  global const int* restrict pvt, uint a_size, uint batch) {
+	const ulong matrix_elements = (ulong) a_size * a_size * BLOCK_SIZE
+															* BLOCK_SIZE;
+
+	for (uint matrix = 0; matrix < batch; matrix++) {
+		solve_lu(a + matrix * matrix_elements,
+				 b + (ulong) matrix * a_size * BLOCK_SIZE,
+				 pvt + (ulong) matrix * a_size * BLOCK_SIZE, a_size);
+	}
+}
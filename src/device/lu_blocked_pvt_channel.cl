@@ -0,0 +1,626 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+LU factorization with pivoting over the diagonal blocks that is split into
+five kernels connected by channels:
+
+- gefa_read: Reads all blocks from global memory and forwards them to the
+  panel and update kernel
+- gefa_panel: LU factorization of the diagonal block (C1) and update of the
+  left (C2) and top blocks (C3)
+- gefa_update: Distributes the update of the inner blocks (C4) round-robin
+  over the replicated C4 units
+- gefa_c4_unit: Autorun kernel that is replicated REPLICATIONS times and
+  calculates C4 for the inner blocks it receives
+- gefa_store_panel, gefa_store_update: Write the results of the panel and
+  update kernel back to global memory
+
+The panel of the next diagonal block is calculated as soon as the first
+column of inner blocks is updated. So the update of the remaining inner blocks
+overlaps with the loading and the panel calculation of the next step.
+The writers send a token for every stored block to the reader. The reader
+uses them to only read blocks that are already updated in global memory.
+*/
+
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include "lu_blocked_pvt_common.h"
+
+#if MEMORY_BANKS > 1
+#error "Only the blocked_pvt kernel supports multiple memory banks"
+#endif
+
+/**
+Number of replicated C4 units that are used to update the inner blocks
+*/
+#ifndef REPLICATIONS
+#define REPLICATIONS 1
+#endif
+
+/**
+Depth of the channels that are used to send back the tokens of stored blocks
+*/
+#define TOKEN_CHANNEL_DEPTH 16
+
+/**
+A single row of a block that is sent over a channel
+*/
+typedef struct {
+	DATA_TYPE data[BLOCK_SIZE];
+} block_row;
+
+// Blocks that are processed by C1, C2 and C3
+channel block_row ch_read_panel __attribute__((depth(BLOCK_SIZE)));
+// Left blocks and inner blocks for C4
+channel block_row ch_read_left __attribute__((depth(BLOCK_SIZE)));
+channel block_row ch_read_inner __attribute__((depth(BLOCK_SIZE)));
+// Top blocks calculated by C3 that are used by C4
+channel block_row ch_panel_top __attribute__((depth(BLOCK_SIZE)));
+// Number of inner blocks, the top block and the left and inner blocks for
+// every C4 unit
+channel uint ch_unit_count[REPLICATIONS] __attribute__((depth(1)));
+channel block_row ch_unit_top[REPLICATIONS] __attribute__((depth(BLOCK_SIZE)));
+channel block_row ch_unit_left[REPLICATIONS] __attribute__((depth(BLOCK_SIZE)));
+channel block_row ch_unit_inner[REPLICATIONS]
+											__attribute__((depth(BLOCK_SIZE)));
+// Calculated blocks that have to be written back to global memory
+channel block_row ch_panel_store __attribute__((depth(BLOCK_SIZE)));
+channel block_row ch_unit_store[REPLICATIONS]
+											__attribute__((depth(BLOCK_SIZE)));
+// Tokens for every block that is stored in global memory
+channel int ch_panel_stored __attribute__((depth(TOKEN_CHANNEL_DEPTH)));
+channel int ch_update_stored __attribute__((depth(TOKEN_CHANNEL_DEPTH)));
+
+
+/**
+Read a single row of a block from global memory
+
+@param a the global memory buffer of the Matrix
+@param x_block x position of the block
+@param y_block y position of the block
+@param row row within the block
+@param lda_block LDA of the matrix in number of blocks
+@return the row of the block
+*/
+block_row
+read_row(global volatile DATA_TYPE* restrict a, uint x_block, uint y_block,
+		 uint row, uint lda_block) {
+	block_row r;
+	#pragma unroll GLOBAL_MEM_UNROLL
+	for (int j = 0; j < BLOCK_SIZE; j++) {
+		r.data[j] = a[element_index(x_block, y_block, row, j, lda_block)];
+	}
+	return r;
+}
+
+
+/**
+Store a single row of a block to global memory
+
+@param r the row of the block
+@param a the global memory buffer of the Matrix
+@param x_block x position of the block
+@param y_block y position of the block
+@param row row within the block
+@param lda_block LDA of the matrix in number of blocks
+*/
+void
+write_row(block_row r, global DATA_TYPE* restrict a, uint x_block,
+		  uint y_block, uint row, uint lda_block) {
+	#pragma unroll GLOBAL_MEM_UNROLL
+	for (int j = 0; j < BLOCK_SIZE; j++) {
+		a[element_index(x_block, y_block, row, j, lda_block)] = r.data[j];
+	}
+}
+
+
+/**
+Count the tokens of the writers without blocking.
+It is called for every row that is sent by the reader, so the writers are
+never stalled by full token channels.
+
+@param panel_stored number of blocks stored by gefa_store_panel
+@param update_stored number of blocks stored by gefa_store_update
+*/
+void
+count_stored_blocks(uint* panel_stored, uint* update_stored) {
+	bool valid;
+	read_channel_nb_intel(ch_panel_stored, &valid);
+	*panel_stored += valid ? 1 : 0;
+	read_channel_nb_intel(ch_update_stored, &valid);
+	*update_stored += valid ? 1 : 0;
+}
+
+
+/**
+Send the diagonal block and all left blocks of a diagonal step to the
+panel kernel
+
+@param a the global memory buffer of the Matrix
+@param diagonal_block the diagonal block of the step
+@param a_size the x and y size of the matrix in blocks
+@param panel_stored number of blocks stored by gefa_store_panel
+@param update_stored number of blocks stored by gefa_store_update
+*/
+void
+read_panel_blocks(global volatile DATA_TYPE* restrict a, uint diagonal_block,
+				  uint a_size, uint* panel_stored, uint* update_stored) {
+	for (int y_block = diagonal_block; y_block < a_size; y_block++) {
+		for (int i = 0; i < BLOCK_SIZE; i++) {
+			write_channel_intel(ch_read_panel, read_row(a, diagonal_block,
+													y_block, i, a_size));
+			count_stored_blocks(panel_stored, update_stored);
+		}
+	}
+}
+
+
+/**
+Receive a block from the panel input channel
+
+@param a_block local memory buffer to store the block in
+*/
+void
+receive_panel_block(DATA_TYPE a_block[BLOCK_SIZE][BLOCK_SIZE]) {
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		block_row r = read_channel_intel(ch_read_panel);
+		#pragma unroll
+		for (int j = 0; j < BLOCK_SIZE; j++) {
+			a_block[i][j] = r.data[j];
+		}
+	}
+}
+
+
+/**
+Send a block calculated by the panel kernel to its writer
+
+@param a_block local memory buffer of the block
+*/
+void
+send_panel_store(DATA_TYPE a_block[BLOCK_SIZE][BLOCK_SIZE]) {
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		block_row r;
+		#pragma unroll
+		for (int j = 0; j < BLOCK_SIZE; j++) {
+			r.data[j] = a_block[i][j];
+		}
+		write_channel_intel(ch_panel_store, r);
+	}
+}
+
+
+/**
+LU factorization of the diagonal block (C1) and update of all left blocks
+below it (C2). The blocks are received from the reader in the same order.
+
+@param diagonal_block the diagonal block of the step
+@param a_size the x and y size of the matrix in blocks
+@param diag_block_out Buffer for the LU factorized diagonal block
+@param scale_factors Buffer for the scale factors of the factorization
+@param ipvt Buffer for the pivoting information of the factorization
+@param pvt Pivoting information in global memory
+*/
+void
+panel_factorization(uint diagonal_block, uint a_size,
+					DATA_TYPE diag_block_out[BLOCK_SIZE][BLOCK_SIZE],
+					DATA_TYPE scale_factors[BLOCK_SIZE],
+					int ipvt[BLOCK_SIZE],
+					global int* restrict pvt) {
+	DATA_TYPE diag_block[BLOCK_SIZE][BLOCK_SIZE];
+	receive_panel_block(diag_block);
+
+	lu_factorization_c1(diag_block, diag_block_out, scale_factors, ipvt);
+
+	#pragma unroll GLOBAL_MEM_UNROLL
+	for (int i=0; i<BLOCK_SIZE; i++) {
+		pvt[diagonal_block * BLOCK_SIZE + i] = diagonal_block * BLOCK_SIZE
+															+ ipvt[i];
+	}
+
+	send_panel_store(diag_block_out);
+
+	for (int inner_block = diagonal_block + 1; inner_block < a_size;
+		inner_block++) {
+		DATA_TYPE left_block[BLOCK_SIZE][BLOCK_SIZE];
+		DATA_TYPE left_block_out[BLOCK_SIZE][BLOCK_SIZE];
+		receive_panel_block(left_block);
+		left_blocks_c2(diag_block_out, left_block, left_block_out,
+						scale_factors);
+		send_panel_store(left_block_out);
+	}
+}
+
+
+/**
+Returns the column of inner blocks after which the panel of the next
+diagonal block is calculated. The column after the first one is used, so the
+panel kernel can already work on the next diagonal block while the update
+kernel is still busy with the remaining inner blocks.
+
+@param diagonal_block the current diagonal block
+@param a_size the x and y size of the matrix in blocks
+@return the x position of the column
+*/
+uint
+lookahead_column(uint diagonal_block, uint a_size) {
+	return (diagonal_block + 2 < a_size) ? diagonal_block + 2 : a_size - 1;
+}
+
+
+/**
+Reads the blocks from global memory and sends them to the panel and the
+update kernel.
+The tokens of the writers are counted to make sure that only blocks are read
+that were already written back by the previous step.
+
+@param a The data array representing the whole matrix in global memory
+@param a_size the x and y size of the matrix in blocks
+*/
+__attribute__((uses_global_work_offset(0)))
+__kernel
+void gefa_read(global volatile DATA_TYPE* restrict a, uint a_size) {
+
+	// Number of blocks that were sent to the panel kernel and the number of
+	// blocks that were stored by the writers
+	uint panel_sent = 0;
+	uint panel_stored = 0;
+	uint update_stored = 0;
+
+	read_panel_blocks(a, 0, a_size, &panel_stored, &update_stored);
+	panel_sent += a_size;
+	uint panel_needed = panel_sent;
+
+	// Number of stored inner blocks before the current and last step
+	uint step_start = 0;
+	uint last_step_start = 0;
+
+	for (int diagonal_block=0; diagonal_block < a_size; diagonal_block++) {
+		uint inner_blocks = a_size - diagonal_block - 1;
+		uint lookahead = lookahead_column(diagonal_block, a_size);
+		uint next_panel_needed = panel_sent;
+
+		for (int inner_x_block = diagonal_block + 1; inner_x_block < a_size;
+			inner_x_block++) {
+			// Wait until the previous step has stored the whole column
+			uint column_needed = last_step_start + (inner_x_block
+						- diagonal_block + 1) * (inner_blocks + 1);
+			while (diagonal_block > 0 && update_stored < column_needed) {
+				count_stored_blocks(&panel_stored, &update_stored);
+			}
+
+			for (int i = 0; i < BLOCK_SIZE; i++) {
+				write_channel_intel(ch_read_panel, read_row(a, inner_x_block,
+											diagonal_block, i, a_size));
+				count_stored_blocks(&panel_stored, &update_stored);
+			}
+			panel_sent++;
+
+			// Wait until the left blocks of this step are stored
+			while (panel_stored < panel_needed) {
+				count_stored_blocks(&panel_stored, &update_stored);
+			}
+
+			for (int inner_y_block = diagonal_block + 1;
+								inner_y_block < a_size; inner_y_block++) {
+				for (int i = 0; i < BLOCK_SIZE; i++) {
+					write_channel_intel(ch_read_left, read_row(a,
+									diagonal_block, inner_y_block, i, a_size));
+					write_channel_intel(ch_read_inner, read_row(a,
+									inner_x_block, inner_y_block, i, a_size));
+					count_stored_blocks(&panel_stored, &update_stored);
+				}
+			}
+
+			if (inner_x_block == lookahead) {
+				// Wait until the first column of inner blocks is stored
+				// and send the panel of the next diagonal block
+				while (update_stored < step_start + inner_blocks) {
+					count_stored_blocks(&panel_stored, &update_stored);
+				}
+				read_panel_blocks(a, diagonal_block + 1, a_size,
+								  &panel_stored, &update_stored);
+				panel_sent += inner_blocks;
+				next_panel_needed = panel_sent;
+			}
+		}
+		panel_needed = next_panel_needed;
+		last_step_start = step_start;
+		step_start += inner_blocks * inner_blocks;
+	}
+
+	// Wait for the remaining tokens of the writers
+	while (panel_stored < panel_sent || update_stored < step_start) {
+		count_stored_blocks(&panel_stored, &update_stored);
+	}
+}
+
+
+/**
+Calculates C1 and C2 for every diagonal block and C3 for all top blocks.
+The top blocks are sent to the update kernel and the writer.
+Since the panel of the next diagonal block is calculated while the top blocks
+of the current step are still processed, the factorized diagonal blocks are
+double buffered.
+
+@param pvt Pivoting information
+@param a_size the x and y size of the matrix in blocks
+*/
+__attribute__((uses_global_work_offset(0)))
+__kernel
+void gefa_panel(global int* restrict pvt, uint a_size) {
+
+	DATA_TYPE diag_block_out[2][BLOCK_SIZE][BLOCK_SIZE];
+	DATA_TYPE scale_factors[2][BLOCK_SIZE];
+	int ipvt[2][BLOCK_SIZE];
+
+	panel_factorization(0, a_size, diag_block_out[0], scale_factors[0],
+						ipvt[0], pvt);
+
+	for (int diagonal_block=0; diagonal_block < a_size; diagonal_block++) {
+		uint current = diagonal_block & 1;
+		uint lookahead = lookahead_column(diagonal_block, a_size);
+
+		for (int inner_x_block = diagonal_block + 1; inner_x_block < a_size;
+			inner_x_block++) {
+			DATA_TYPE top_block[BLOCK_SIZE][BLOCK_SIZE];
+			DATA_TYPE top_block_out[BLOCK_SIZE][BLOCK_SIZE];
+			receive_panel_block(top_block);
+			top_blocks_c3(diag_block_out[current], top_block, top_block_out,
+						  ipvt[current]);
+			for (int i = 0; i < BLOCK_SIZE; i++) {
+				block_row r;
+				#pragma unroll
+				for (int j = 0; j < BLOCK_SIZE; j++) {
+					r.data[j] = top_block_out[i][j];
+				}
+				write_channel_intel(ch_panel_top, r);
+				write_channel_intel(ch_panel_store, r);
+			}
+
+			if (inner_x_block == lookahead) {
+				panel_factorization(diagonal_block + 1, a_size,
+									diag_block_out[1 - current],
+									scale_factors[1 - current],
+									ipvt[1 - current], pvt);
+			}
+		}
+	}
+}
+
+
+/**
+Distributes the calculation of C4 over the C4 units.
+The inner blocks of a column are assigned round-robin to the units. Every
+unit that gets blocks of the column first receives their number and a copy
+of the top block from the panel kernel. The left and inner blocks are
+received from the reader.
+
+@param a_size the x and y size of the matrix in blocks
+@param replications number of C4 units that are used. Has to be between 1
+		and REPLICATIONS.
+*/
+__attribute__((uses_global_work_offset(0)))
+__kernel
+void gefa_update(uint a_size, uint replications) {
+
+	for (int diagonal_block=0; diagonal_block < a_size; diagonal_block++) {
+		uint inner_blocks = a_size - diagonal_block - 1;
+
+		for (int inner_x_block = diagonal_block + 1; inner_x_block < a_size;
+			inner_x_block++) {
+			#pragma unroll
+			for (int r = 0; r < REPLICATIONS; r++) {
+				if (r < replications && r < inner_blocks) {
+					write_channel_intel(ch_unit_count[r], (inner_blocks - r
+									+ replications - 1) / replications);
+				}
+			}
+
+			for (int i = 0; i < BLOCK_SIZE; i++) {
+				block_row top = read_channel_intel(ch_panel_top);
+				#pragma unroll
+				for (int r = 0; r < REPLICATIONS; r++) {
+					if (r < replications && r < inner_blocks) {
+						write_channel_intel(ch_unit_top[r], top);
+					}
+				}
+			}
+
+			uint unit = 0;
+			for (int inner_y_block = diagonal_block + 1;
+								inner_y_block < a_size; inner_y_block++) {
+				for (int i = 0; i < BLOCK_SIZE; i++) {
+					block_row left = read_channel_intel(ch_read_left);
+					block_row inner = read_channel_intel(ch_read_inner);
+					#pragma unroll
+					for (int r = 0; r < REPLICATIONS; r++) {
+						if (r == unit) {
+							write_channel_intel(ch_unit_left[r], left);
+							write_channel_intel(ch_unit_inner[r], inner);
+						}
+					}
+				}
+				unit = (unit + 1 < replications) ? unit + 1 : 0;
+			}
+		}
+	}
+}
+
+
+/**
+C4 unit that updates the inner blocks it receives from gefa_update.
+The kernel is replicated and every compute unit uses its own channels.
+*/
+__attribute__((max_global_work_dim(0)))
+__attribute__((autorun))
+__attribute__((num_compute_units(REPLICATIONS)))
+__kernel
+void gefa_c4_unit() {
+	const int id = get_compute_id(0);
+
+	while (true) {
+		uint count = read_channel_intel(ch_unit_count[id]);
+
+		DATA_TYPE top_block_out[BLOCK_SIZE][BLOCK_SIZE];
+		for (int i = 0; i < BLOCK_SIZE; i++) {
+			block_row r = read_channel_intel(ch_unit_top[id]);
+			#pragma unroll
+			for (int j = 0; j < BLOCK_SIZE; j++) {
+				top_block_out[i][j] = r.data[j];
+			}
+		}
+
+		for (int block = 0; block < count; block++) {
+			DATA_TYPE left_block_out[BLOCK_SIZE][BLOCK_SIZE];
+			DATA_TYPE current_block[BLOCK_SIZE][BLOCK_SIZE];
+			DATA_TYPE current_block_out[BLOCK_SIZE][BLOCK_SIZE];
+			for (int i = 0; i < BLOCK_SIZE; i++) {
+				block_row left = read_channel_intel(ch_unit_left[id]);
+				block_row inner = read_channel_intel(ch_unit_inner[id]);
+				#pragma unroll
+				for (int j = 0; j < BLOCK_SIZE; j++) {
+					left_block_out[i][j] = left.data[j];
+					current_block[i][j] = inner.data[j];
+				}
+			}
+
+			inner_blocks_c4(left_block_out, top_block_out, current_block,
+												current_block_out);
+
+			for (int i = 0; i < BLOCK_SIZE; i++) {
+				block_row r;
+				#pragma unroll
+				for (int j = 0; j < BLOCK_SIZE; j++) {
+					r.data[j] = current_block_out[i][j];
+				}
+				write_channel_intel(ch_unit_store[id], r);
+			}
+		}
+	}
+}
+
+
+/**
+Writes the blocks calculated by the panel kernel back to global memory.
+The blocks are received in the same order as they are calculated in
+gefa_panel.
+
+@param a The data array representing the whole matrix in global memory
+@param a_size the x and y size of the matrix in blocks
+*/
+__attribute__((uses_global_work_offset(0)))
+__kernel
+void gefa_store_panel(global DATA_TYPE* restrict a, uint a_size) {
+
+	for (int y_block = 0; y_block < a_size; y_block++) {
+		for (int i = 0; i < BLOCK_SIZE; i++) {
+			write_row(read_channel_intel(ch_panel_store), a, 0, y_block, i,
+					  a_size);
+		}
+		mem_fence(CLK_GLOBAL_MEM_FENCE | CLK_CHANNEL_MEM_FENCE);
+		write_channel_intel(ch_panel_stored, 1);
+	}
+
+	for (int diagonal_block=0; diagonal_block < a_size; diagonal_block++) {
+		uint lookahead = lookahead_column(diagonal_block, a_size);
+
+		for (int inner_x_block = diagonal_block + 1; inner_x_block < a_size;
+			inner_x_block++) {
+			for (int i = 0; i < BLOCK_SIZE; i++) {
+				write_row(read_channel_intel(ch_panel_store), a,
+						  inner_x_block, diagonal_block, i, a_size);
+			}
+			mem_fence(CLK_GLOBAL_MEM_FENCE | CLK_CHANNEL_MEM_FENCE);
+			write_channel_intel(ch_panel_stored, 1);
+
+			if (inner_x_block == lookahead) {
+				for (int y_block = diagonal_block + 1; y_block < a_size;
+					y_block++) {
+					for (int i = 0; i < BLOCK_SIZE; i++) {
+						write_row(read_channel_intel(ch_panel_store), a,
+								  diagonal_block + 1, y_block, i, a_size);
+					}
+					mem_fence(CLK_GLOBAL_MEM_FENCE | CLK_CHANNEL_MEM_FENCE);
+					write_channel_intel(ch_panel_stored, 1);
+				}
+			}
+		}
+	}
+}
+
+
+/**
+Writes the inner blocks calculated by the C4 units back to global memory.
+The blocks are collected from the units in the same round-robin order that
+is used by gefa_update.
+
+@param a The data array representing the whole matrix in global memory
+@param a_size the x and y size of the matrix in blocks
+@param replications number of C4 units that are used
+*/
+__attribute__((uses_global_work_offset(0)))
+__kernel
+void gefa_store_update(global DATA_TYPE* restrict a, uint a_size,
+					   uint replications) {
+
+	for (int diagonal_block=0; diagonal_block < a_size; diagonal_block++) {
+		for (int inner_x_block = diagonal_block + 1; inner_x_block < a_size;
+			inner_x_block++) {
+			uint unit = 0;
+			for (int inner_y_block = diagonal_block + 1;
+								inner_y_block < a_size; inner_y_block++) {
+				for (int i = 0; i < BLOCK_SIZE; i++) {
+					block_row r;
+					#pragma unroll
+					for (int u = 0; u < REPLICATIONS; u++) {
+						if (u == unit) {
+							r = read_channel_intel(ch_unit_store[u]);
+						}
+					}
+					write_row(r, a, inner_x_block, inner_y_block, i, a_size);
+				}
+				mem_fence(CLK_GLOBAL_MEM_FENCE | CLK_CHANNEL_MEM_FENCE);
+				write_channel_intel(ch_update_stored, 1);
+				unit = (unit + 1 < replications) ? unit + 1 : 0;
+			}
+		}
+	}
+}
+
+/**
+Solve kernel that solves the linear equations A*x = b using the LU
+factorization calculated by the gefa kernel.
+
+@param a The data array representing the LU factorized matrix in global memory
+@param b The right-hand side of the equation. Will be overwritten with the
+		 solution x.
+@param pvt Pivoting information calculated by gefa
+@param a_size the x and y size of the matrix in blocks
+*/
+__attribute__((uses_global_work_offset(0)))
+__kernel
+void gesl(global DATA_TYPE* restrict a, global DATA_TYPE* restrict b,
+		  global const int* restrict pvt, uint a_size) {
+	solve_lu(a, b, pvt, a_size);
+}
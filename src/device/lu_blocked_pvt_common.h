@@ -0,0 +1,1152 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+Functions shared by all kernels that calculate the LU factorization with
+pivoting over the diagonal blocks. It also contains the function that
+solves the linear equations using the calculated LU factorization.
+*/
+
+#define DATA_TYPE float
+
+/**
+Specify size of the blocks that will be loaded to local memory for calculation
+*/
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 32
+#endif
+
+/**
+Size of matrix multiplication that is fully unrolled.
+*/
+#define GEMM_BLOCK 8
+
+/**
+If set to 1, the blocks of the matrix are stored contiguously in global
+memory instead of row-major.
+*/
+#ifndef TILE_LAYOUT
+#define TILE_LAYOUT 0
+#endif
+
+/**
+Number of memory banks the matrix is distributed over. The columns of every
+block are distributed round-robin over the banks, so column j of a block is
+stored in the buffer of bank j % MEMORY_BANKS. Every bank contains the whole
+matrix with blocks of BLOCK_SIZE / MEMORY_BANKS columns. Every bank is a
+separate kernel argument, so the host can place the buffers in different
+memory banks if memory interleaving is disabled. The unrolled loops over
+the columns of a block then access all banks in parallel, and the bank of
+every unrolled access is known at compile time.
+Supported values are 1, 2 and 4.
+*/
+#ifndef MEMORY_BANKS
+#define MEMORY_BANKS 1
+#endif
+
+/**
+Number of left blocks that are kept in the on-chip panel buffer during the
+update of the inner blocks in gefa_step. If 0, the left and top blocks are
+loaded from global memory for every inner block.
+*/
+#ifndef PANEL_BLOCKS
+#define PANEL_BLOCKS 0
+#endif
+
+/**
+Parameter and argument list of a matrix that is distributed over the memory
+banks. The buffer of bank i gets the given name with the suffix i.
+*/
+#if MEMORY_BANKS == 1
+#define MATRIX_PARAMS(name) global DATA_TYPE* restrict name
+#define MATRIX_ARGS(name) name
+#elif MEMORY_BANKS == 2
+#define MATRIX_PARAMS(name) global DATA_TYPE* restrict name##0, \
+							global DATA_TYPE* restrict name##1
+#define MATRIX_ARGS(name) name##0, name##1
+#elif MEMORY_BANKS == 4
+#define MATRIX_PARAMS(name) global DATA_TYPE* restrict name##0, \
+							global DATA_TYPE* restrict name##1, \
+							global DATA_TYPE* restrict name##2, \
+							global DATA_TYPE* restrict name##3
+#define MATRIX_ARGS(name) name##0, name##1, name##2, name##3
+#else
+#error "MEMORY_BANKS must be 1, 2 or 4"
+#endif
+
+#if GLOBAL_MEM_UNROLL % MEMORY_BANKS != 0
+#error "GLOBAL_MEM_UNROLL must be a multiple of MEMORY_BANKS"
+#endif
+
+/**
+Ignores the loop-carried dependencies of a loop only for the buffers of the
+matrix in global memory. The dependencies of the private buffers of the loop
+are still checked by the compiler.
+*/
+#define PRAGMA(x) _Pragma(#x)
+#if MEMORY_BANKS == 1
+#define MATRIX_IVDEP(name) PRAGMA(ivdep array(name))
+#elif MEMORY_BANKS == 2
+#define MATRIX_IVDEP(name) PRAGMA(ivdep array(name##0)) \
+							PRAGMA(ivdep array(name##1))
+#else
+#define MATRIX_IVDEP(name) PRAGMA(ivdep array(name##0)) \
+							PRAGMA(ivdep array(name##1)) \
+							PRAGMA(ivdep array(name##2)) \
+							PRAGMA(ivdep array(name##3))
+#endif
+
+/**
+Must be logarithm of the chosen block size.
+It is used for the maximum calculation.
+*/
+#ifndef BLOCK_SIZE_LOG
+#define BLOCK_SIZE_LOG 5
+#endif
+
+
+/**
+Calculates the index of an element of a block in global memory.
+With TILE_LAYOUT, every block is stored contiguously in memory and the
+blocks are stored row by row. Otherwise, the matrix is stored row-major.
+
+@param x_block x position of the block
+@param y_block y position of the block
+@param row row within the block
+@param col column within the block
+@param lda_block LDA of the matrix in number of blocks
+@return the index of the element in the global memory buffer
+*/
+uint
+element_index(uint x_block, uint y_block, uint row, uint col,
+			  uint lda_block) {
+#if TILE_LAYOUT
+	return ((y_block * lda_block + x_block) * BLOCK_SIZE + row) * BLOCK_SIZE
+																+ col;
+#else
+	return (y_block * lda_block * BLOCK_SIZE + x_block) * BLOCK_SIZE + col
+										+ row * lda_block * BLOCK_SIZE;
+#endif
+}
+
+
+#if MEMORY_BANKS > 1
+/**
+Calculates the index of an element of the matrix in the buffer of its
+memory bank. The buffer of a bank is stored in the same layout as the whole
+matrix, but every block only contains BLOCK_SIZE / MEMORY_BANKS columns.
+
+@param x_block x position of the block
+@param y_block y position of the block
+@param row row within the block
+@param col column within the block
+@param lda_block LDA of the whole matrix in number of blocks
+@return the index of the element in the buffer of the bank
+*/
+uint
+bank_index(uint x_block, uint y_block, uint row, uint col, uint lda_block) {
+	const uint width = BLOCK_SIZE / MEMORY_BANKS;
+#if TILE_LAYOUT
+	return ((y_block * lda_block + x_block) * BLOCK_SIZE + row) * width
+													+ col / MEMORY_BANKS;
+#else
+	return (y_block * BLOCK_SIZE + row) * lda_block * width + x_block * width
+													+ col / MEMORY_BANKS;
+#endif
+}
+#endif
+
+
+/**
+Read an element of the matrix from the memory bank of its column
+
+@param a the global memory buffers of the matrix
+@param x_block x position of the block
+@param y_block y position of the block
+@param row row within the block
+@param col column within the block
+@param lda_block LDA of the whole matrix in number of blocks
+@return the value of the element
+*/
+DATA_TYPE
+read_element(MATRIX_PARAMS(a), uint x_block, uint y_block, uint row,
+			 uint col, uint lda_block) {
+#if MEMORY_BANKS == 1
+	return a[element_index(x_block, y_block, row, col, lda_block)];
+#else
+	uint index = bank_index(x_block, y_block, row, col, lda_block);
+	switch (col % MEMORY_BANKS) {
+		case 0: return a0[index];
+		case 1: return a1[index];
+#if MEMORY_BANKS == 4
+		case 2: return a2[index];
+		case 3: return a3[index];
+#endif
+	}
+	return 0;
+#endif
+}
+
+
+/**
+Write an element of the matrix to the memory bank of its column
+
+@param a the global memory buffers of the matrix
+@param x_block x position of the block
+@param y_block y position of the block
+@param row row within the block
+@param col column within the block
+@param lda_block LDA of the whole matrix in number of blocks
+@param value the new value of the element
+*/
+void
+write_element(MATRIX_PARAMS(a), uint x_block, uint y_block, uint row,
+			  uint col, uint lda_block, DATA_TYPE value) {
+#if MEMORY_BANKS == 1
+	a[element_index(x_block, y_block, row, col, lda_block)] = value;
+#else
+	uint index = bank_index(x_block, y_block, row, col, lda_block);
+	switch (col % MEMORY_BANKS) {
+		case 0: a0[index] = value; break;
+		case 1: a1[index] = value; break;
+#if MEMORY_BANKS == 4
+		case 2: a2[index] = value; break;
+		case 3: a3[index] = value; break;
+#endif
+	}
+#endif
+}
+
+
+/**
+Load a block from global memory
+
+@param a_block local memory buffer to store the block in
+@param a the global memory buffers of the Matrix
+@param x_block x position of the block
+@param y_block y position of the block
+@param lda_block LDA of the matrix in number of blocks
+*/
+void
+load_block(DATA_TYPE a_block[BLOCK_SIZE][BLOCK_SIZE],
+			MATRIX_PARAMS(a),
+			uint x_block, uint y_block, uint lda_block) {
+
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		#pragma unroll GLOBAL_MEM_UNROLL
+		for (int j = 0; j < BLOCK_SIZE; j++) {
+			a_block[i][j] = read_element(MATRIX_ARGS(a), x_block, y_block,
+										 i, j, lda_block);
+		}
+	}
+}
+
+
+/**
+Store a block to global memory
+
+@param a_block local memory buffer to load the block from
+@param a the global memory buffers of the Matrix
+@param x_block x position of the block
+@param y_block y position of the block
+@param lda_block LDA of the matrix in number of blocks
+*/
+void
+store_block(DATA_TYPE a_block[BLOCK_SIZE][BLOCK_SIZE],
+			MATRIX_PARAMS(a),
+			uint x_block, uint y_block, uint lda_block) {
+
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		#pragma unroll GLOBAL_MEM_UNROLL
+		for (int j = 0; j < BLOCK_SIZE; j++) {
+			write_element(MATRIX_ARGS(a), x_block, y_block, i, j, lda_block,
+						  a_block[i][j]);
+		}
+	}
+}
+
+
+/**
+Calculate
+
+c = c +  a.dot(b)
+
+where a,b,c are matrices of size GEMM_BLOCK.
+Calculation itself is fully unrolled.
+ */
+void local_gemm_8x8(const DATA_TYPE a[GEMM_BLOCK][GEMM_BLOCK],
+                    const DATA_TYPE b[GEMM_BLOCK][GEMM_BLOCK],
+                    DATA_TYPE c_out[GEMM_BLOCK][GEMM_BLOCK]) {
+
+    DATA_TYPE a_block[GEMM_BLOCK][GEMM_BLOCK + 1];
+    DATA_TYPE b_block[GEMM_BLOCK + 1][GEMM_BLOCK];
+	DATA_TYPE c_block[GEMM_BLOCK][GEMM_BLOCK];
+
+    // Load block of matrix A and B and init C and reorder values
+    #pragma unroll
+    for (int y=0; y<GEMM_BLOCK; y++) {
+        #pragma unroll
+        for (int x=0; x<GEMM_BLOCK; x++) {
+            int k = (x + y) % GEMM_BLOCK;
+            a_block[y][x] = a[y][k];
+            b_block[y][x] = b[k][x];
+            c_block[y][x] = 0;
+        }
+    }
+
+    // Calculate result for 8x8 matrix
+    #pragma unroll
+    for (int i=0;i<GEMM_BLOCK; i++) {
+        #pragma unroll
+        for (int x=0; x<GEMM_BLOCK;x++) {
+            a_block[x][GEMM_BLOCK] = a_block[x][0];
+            b_block[GEMM_BLOCK][x] = b_block[0][x];
+        }
+        #pragma unroll
+        for(int y=0; y < GEMM_BLOCK; y++) {
+            #pragma unroll
+            for (int x=0; x<GEMM_BLOCK;x++) {
+                c_block[y][x] += a_block[y][x] * b_block[y][x];
+                a_block[y][x] = a_block[y][x + 1];
+                b_block[y][x] = b_block[y + 1][x];
+            }
+        }
+    }
+
+	#pragma unroll
+	for(int y=0; y < GEMM_BLOCK; y++) {
+		#pragma unroll
+		for (int x=0; x<GEMM_BLOCK;x++) {
+			c_out[y][x] += c_block[y][x];
+		}
+	}
+}
+
+
+/**
+Searches for the index of the absoulte maximum in the column and returns it.
+
+@param column The array containing the current column
+@param current_k The current column
+@returns index of the absolute maximum of the values between k and BLOCK_SIZE
+*/
+int
+argmax(const DATA_TYPE column[BLOCK_SIZE], const int current_k) {
+	DATA_TYPE prepared_col[BLOCK_SIZE_LOG + 1][BLOCK_SIZE];
+	DATA_TYPE prepared_col_index[BLOCK_SIZE_LOG + 1][BLOCK_SIZE];
+	// Initialize first row of values and indices
+	#pragma unroll
+	for (int i=0; i < BLOCK_SIZE; i++) {
+		if (i < current_k) {
+			prepared_col[0][i] = 0;
+		} else {
+			prepared_col[0][i] = fabs(column[i]);
+		}
+		prepared_col_index[0][i] = i;
+	}
+	// Fully unroll maximum calculation
+	int remaining_vals = BLOCK_SIZE;
+	#pragma unroll
+	for (int stage=1; stage <= BLOCK_SIZE_LOG; stage++) {
+		remaining_vals = remaining_vals >> 1;
+		#pragma unroll
+		for (int i=0; i < remaining_vals; i++) {
+			if (prepared_col[stage - 1][i] > prepared_col[stage - 1]
+														[i + remaining_vals]) {
+				prepared_col[stage][i] = prepared_col[stage - 1][i];
+				prepared_col_index[stage][i] = prepared_col_index[stage - 1][i];
+			} else {
+				prepared_col[stage][i] = prepared_col[stage - 1]
+														[i + remaining_vals];
+				prepared_col_index[stage][i] = prepared_col_index[stage - 1]
+														[i + remaining_vals];
+			}
+		}
+	}
+	// The first value in the last row contains the maximum index
+	return prepared_col_index[BLOCK_SIZE_LOG][0];
+}
+
+
+/**
+Standard LU factorization on a block with fixed size
+
+Case 1 of Zhangs description
+
+TODO: This routine is not optimized yet and just offer basic functionality
+
+@param a_block_in Input block that has to be LU factorized
+@param a_block_out Output block to write the result
+@param scale_factors scaling factors that where used to scale the columns. They can be reused in C2
+@param ipvt Pivoting information for C3 and solving of the system
+*/
+void
+lu_factorization_c1(const DATA_TYPE a_block_in[BLOCK_SIZE][BLOCK_SIZE],
+					DATA_TYPE a_block_out[BLOCK_SIZE][BLOCK_SIZE],
+					DATA_TYPE scale_factors[BLOCK_SIZE],
+					int ipvt[BLOCK_SIZE]) {
+
+	DATA_TYPE tmp_block_write[BLOCK_SIZE][BLOCK_SIZE];
+	DATA_TYPE tmp_block_read[BLOCK_SIZE][BLOCK_SIZE];
+
+	// copy columnwise
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		#pragma unroll
+		for (int j = 0; j <  BLOCK_SIZE; j++) {
+			tmp_block_read[i][j] = a_block_in[i][j];
+		}
+	}
+
+	#pragma unroll
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		ipvt[i] = i;
+	}
+
+	// For each diagnonal element
+	#pragma max_concurrency 1
+	for (int k = 0; k < BLOCK_SIZE; k++) {
+
+		DATA_TYPE tmp_scale_col[BLOCK_SIZE];
+		int col_order[BLOCK_SIZE];
+		#pragma unroll
+		for (int i=0; i < BLOCK_SIZE; i++) {
+			col_order[i] = i;
+		}
+
+		DATA_TYPE current_col[BLOCK_SIZE];
+		#pragma unroll
+		for (int i=0; i<BLOCK_SIZE; i++) {
+			current_col[i] = tmp_block_read[i][k];
+		}
+		int pivot_col = argmax(current_col, k);
+		ipvt[k] = pivot_col;
+		col_order[pivot_col] = k;
+		col_order[k] = pivot_col;
+
+
+		scale_factors[k] = -1.0 / tmp_block_read[col_order[k]][k];
+		#pragma unroll
+		for (int i = k + 1; i < BLOCK_SIZE; i++) {
+			tmp_scale_col[i] =  current_col[col_order[i]] * scale_factors[k];
+			tmp_block_write[i][k] = tmp_scale_col[i];
+		}
+		#pragma unroll
+		for (int i = k; i < BLOCK_SIZE; i++) {
+			tmp_block_write[k][i] = tmp_block_read[col_order[k]][i];
+		}
+
+		// For each column right of current diagonal element
+		for (int j = k + 1; j < BLOCK_SIZE; j++) {
+			// For each element below it
+			#pragma unroll BLOCK_SIZE
+			for (int i = 0; i < BLOCK_SIZE; i++) {
+				if (i > k) {
+					tmp_block_write[j][i] = tmp_block_read[col_order[j]][i]
+						+ tmp_scale_col[j] * tmp_block_read[col_order[k]][i];
+				}
+			}
+		}
+		#pragma unroll
+		for (int i = k; i < BLOCK_SIZE; i++) {
+			#pragma unroll
+			for (int j = 0; j <  BLOCK_SIZE; j++) {
+				tmp_block_read[i][j] = tmp_block_write[i][j];
+			}
+		}
+	}
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		#pragma unroll
+		for (int j = 0; j <  BLOCK_SIZE; j++) {
+			a_block_out[i][j] = tmp_block_read[i][j];
+		}
+	}
+
+}
+
+
+/**
+Modifying the blocks on the leftmost side
+
+Case 2 of Zhangs description
+
+TODO: This routine is not optimized yet and just offer basic functionality
+
+@param top_block LU factorized top block
+@param current_block_in Current input block
+@param current_block_out Block to write the output to
+@param scale_factors Scale factors that were calculated during LU factorization
+*/
+void
+left_blocks_c2(const DATA_TYPE top_block[BLOCK_SIZE][BLOCK_SIZE],
+				const DATA_TYPE current_block_in[BLOCK_SIZE][BLOCK_SIZE],
+				DATA_TYPE current_block_out[BLOCK_SIZE][BLOCK_SIZE],
+				const DATA_TYPE scale_factors[BLOCK_SIZE]) {
+
+	DATA_TYPE tmp_block_write2[BLOCK_SIZE][BLOCK_SIZE];
+	DATA_TYPE tmp_block_read2[BLOCK_SIZE][BLOCK_SIZE];
+	DATA_TYPE tmp_scale_col[BLOCK_SIZE];
+
+	// copy columnwise
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		#pragma unroll
+		for (int j = 0; j <  BLOCK_SIZE; j++) {
+			tmp_block_read2[i][j] = current_block_in[j][i];
+		}
+	}
+	// For each diagonal element in top block
+	#pragma max_concurrency 1
+	for (int k=0; k < BLOCK_SIZE; k++) {
+		// For each element below it in current block
+		#pragma unroll
+		for (int i=0; i < BLOCK_SIZE; i++) {
+			// printf("C2: %f * %f\n",tmp_block2[i][k], scale_factors[k]);
+			tmp_scale_col[i] = tmp_block_read2[k][i] * scale_factors[k];
+			tmp_block_write2[k][i] = tmp_scale_col[i];
+		}
+		// For each column right of the current diagnonal element
+		for (int j = k+1; j < BLOCK_SIZE; j++) {
+			#pragma unroll
+			for (int i = 0; i < BLOCK_SIZE; i++) {
+				tmp_block_write2[j][i] =
+							tmp_block_read2[j][i] + tmp_scale_col[i]
+												* top_block[k][j];
+			}
+		}
+		for (int i = k; i < BLOCK_SIZE; i++) {
+			#pragma unroll
+			for (int j = 0; j <  BLOCK_SIZE; j++) {
+				tmp_block_read2[i][j] = tmp_block_write2[i][j];
+			}
+		}
+	}
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		#pragma unroll
+		for (int j = 0; j <  BLOCK_SIZE; j++) {
+			current_block_out[j][i] = tmp_block_write2[i][j];
+		}
+	}
+}
+
+
+/**
+Modifying the blocks on the top but not on the left
+
+Case 3 of Zhangs description
+
+TODO: This routine is not optimized yet and just offer basic functionality
+
+@param left_block LU factorized left block
+@param current_block_in Current input block
+@param current_block_out Block to write the output to
+@param ipvt Pivot information created by the LU factorization
+*/
+void
+top_blocks_c3(const DATA_TYPE left_block[BLOCK_SIZE][BLOCK_SIZE],
+			  const DATA_TYPE current_block_in[BLOCK_SIZE][BLOCK_SIZE],
+			  DATA_TYPE current_block_out[BLOCK_SIZE][BLOCK_SIZE],
+			  int ipvt[BLOCK_SIZE]) {
+	DATA_TYPE tmp_block_read3[BLOCK_SIZE][BLOCK_SIZE];
+	DATA_TYPE tmp_block_write3[BLOCK_SIZE][BLOCK_SIZE];
+
+	for (int j = 0; j < BLOCK_SIZE; j++) {
+		#pragma unroll
+		for (int i = 0; i <  BLOCK_SIZE; i++) {
+			tmp_block_read3[j][i] = current_block_in[j][i];
+		}
+	}
+
+	// For each diagonal element in left block
+	#pragma max_concurrency 1
+	for (int k=0; k < BLOCK_SIZE; k++) {
+		uint col_order[BLOCK_SIZE];
+		#pragma unroll
+		for (int i=0; i < BLOCK_SIZE; i++) {
+			col_order[i] = i;
+		}
+		col_order[k] = ipvt[k];
+		col_order[ipvt[k]] = k;
+		// For each column in current block
+		for (int j = k; j < BLOCK_SIZE; j++) {
+			DATA_TYPE multiply = 0.0;
+			// For each element below it
+			if (j > k) {
+				multiply = left_block[j][k];
+			}
+			#pragma unroll
+			for (int i = 0; i < BLOCK_SIZE; i++) {
+				tmp_block_write3[j][i] = tmp_block_read3[col_order[j]][i]
+					+ multiply * tmp_block_read3[col_order[k]][i];
+			}
+		}
+		for (int j = k; j < BLOCK_SIZE; j++) {
+			#pragma unroll
+			for (int i = 0; i <  BLOCK_SIZE; i++) {
+				tmp_block_read3[j][i] = tmp_block_write3[j][i];
+			}
+		}
+	}
+	for (int j = 0; j < BLOCK_SIZE; j++) {
+		#pragma unroll
+		for (int i = 0; i <  BLOCK_SIZE; i++) {
+			current_block_out[j][i] = tmp_block_write3[j][i];
+		}
+	}
+}
+
+
+/**
+Modifying the inner blocks
+
+Case 4 of Zhangs description
+
+@param left_block Most left block that was modified by C2 before
+@param top_block Most upper block that was modified by C3 before
+@param current_block_in Current input block
+@param current_block_out Block to write the output to
+*/
+void
+inner_blocks_c4(const DATA_TYPE left_block[BLOCK_SIZE][BLOCK_SIZE],
+				const DATA_TYPE top_block[BLOCK_SIZE][BLOCK_SIZE],
+				DATA_TYPE current_block_in[BLOCK_SIZE][BLOCK_SIZE],
+				DATA_TYPE current_block_out[BLOCK_SIZE][BLOCK_SIZE]) {
+	DATA_TYPE tmp_top_block[BLOCK_SIZE / GEMM_BLOCK][BLOCK_SIZE / GEMM_BLOCK]
+							 [GEMM_BLOCK][GEMM_BLOCK];
+	DATA_TYPE tmp_left_block[BLOCK_SIZE / GEMM_BLOCK][BLOCK_SIZE / GEMM_BLOCK]
+							 [GEMM_BLOCK][GEMM_BLOCK];
+	DATA_TYPE tmp_out_block[BLOCK_SIZE / GEMM_BLOCK][BLOCK_SIZE / GEMM_BLOCK]
+ 							 [GEMM_BLOCK][GEMM_BLOCK];
+
+	// Load the inputs into 8x8 smaller blocks for easier access during
+	// calculation
+	#pragma loop_coalesce
+	for (int i = 0; i < BLOCK_SIZE / GEMM_BLOCK; i++) {
+		for (int j = 0; j < BLOCK_SIZE / GEMM_BLOCK; j++) {
+			#pragma unroll
+			for (int ii = 0; ii < GEMM_BLOCK; ii++) {
+				#pragma unroll
+				for (int jj = 0; jj < GEMM_BLOCK; jj++) {
+					tmp_top_block[i][j][ii][jj] = top_block[i * GEMM_BLOCK + ii]
+														[j * GEMM_BLOCK + jj];
+					tmp_left_block[i][j][ii][jj] = left_block[i * GEMM_BLOCK + ii]
+														[j * GEMM_BLOCK + jj];
+					tmp_out_block[i][j][ii][jj] = current_block_in[i * GEMM_BLOCK + ii]
+														[j * GEMM_BLOCK + jj];
+				}
+			}
+		}
+	}
+
+	#pragma loop_coalesce 2
+	// For each column in top block
+	for (int i = 0; i < BLOCK_SIZE / GEMM_BLOCK; i++) {
+		// For each element below it in current block
+		for (int j = 0; j < BLOCK_SIZE / GEMM_BLOCK; j++) {
+			DATA_TYPE   tmp_small_block_out[GEMM_BLOCK][GEMM_BLOCK];
+			#pragma unroll
+			for (int ii = 0; ii < GEMM_BLOCK; ii++) {
+				#pragma unroll
+				for (int jj = 0; jj < GEMM_BLOCK; jj++) {
+					tmp_small_block_out[ii][jj] = 0;
+				}
+			}
+			// For each diagonal element in left block
+			for (int k=0; k < BLOCK_SIZE / GEMM_BLOCK; k++) {
+				local_gemm_8x8(tmp_left_block[i][k], tmp_top_block[k][j],
+														tmp_small_block_out);
+			}
+			#pragma unroll
+			for (int ii = 0; ii < GEMM_BLOCK; ii++) {
+				#pragma unroll
+				for (int jj = 0; jj < GEMM_BLOCK; jj++) {
+					current_block_out[i * GEMM_BLOCK + ii]
+						[j * GEMM_BLOCK + jj] = tmp_out_block[i][j][ii][jj]
+						+ tmp_small_block_out[ii][jj];
+				}
+			}
+		}
+	}
+}
+
+
+/*
+Indices of the stage counters of gefa_step. The host uses the same order in
+bm_execution::StageCounter.
+*/
+#define STAT_C1_BLOCKS 0
+#define STAT_C2_BLOCKS 1
+#define STAT_C3_BLOCKS 2
+#define STAT_C4_BLOCKS 3
+#define STAT_C1_CYCLES 4
+#define STAT_C2_C3_CYCLES 5
+#define STAT_C4_CYCLES 6
+#define STAT_TOTAL_CYCLES 7
+#define STAT_LOADED_BLOCKS 8
+#define STAT_STORED_BLOCKS 9
+#define STAT_COUNT 10
+
+/**
+Hooks that count the blocks and cycles of the stages in gefa_step. A kernel
+that measures the stages defines them before it includes this header and
+passes its private counters with STATS_ARG. By default, the hooks are empty.
+*/
+#ifndef STAT_ADD
+#define STAT_ADD(index, value)
+#define STAT_START(name)
+#define STAT_CYCLES(index, name)
+#define STATS_PARAM
+#define STATS_ARG
+#endif
+
+/**
+Calculates the step of the LU factorization for a single diagonal block.
+The diagonal block is factorized with C1, the top and left blocks are
+updated with C3 and C2 and the inner blocks are updated with C4.
+Only the block rows from row_block_start to row_block_end are updated. If
+the diagonal block is above these rows, it was factorized by a previous
+execution and is only loaded.
+The inner blocks are updated with ping-pong buffers, so the next blocks are
+loaded and the last result is stored while C4 is calculated.
+
+@param a The data arrays representing the whole matrix in global memory
+@param pvt Pivoting information of the matrix
+@param diagonal_block the diagonal block of the step
+@param a_size the x and y size of the matrix in blocks
+@param row_block_start the first block row that is updated
+@param row_block_end the block row after the last one that is updated
+@param stats The private stage counters of the kernel. Only used if the
+			 kernel defines the hooks of the counters.
+*/
+void
+gefa_step(MATRIX_PARAMS(a), global int* restrict pvt, int diagonal_block,
+		  uint a_size, uint row_block_start, uint row_block_end
+		  STATS_PARAM) {
+	STAT_START(c1_start);
+	DATA_TYPE diag_block_out[BLOCK_SIZE][BLOCK_SIZE];
+	DATA_TYPE scale_factors[BLOCK_SIZE];
+	int ipvt[BLOCK_SIZE];
+
+	// The first block row below the diagonal block that is updated
+	int first_block_row = (diagonal_block + 1 > row_block_start) ?
+								diagonal_block + 1 : row_block_start;
+	// The top blocks are only updated with the row of the diagonal block
+	bool update_top = diagonal_block >= row_block_start;
+
+	if (update_top) {
+		DATA_TYPE diag_block[BLOCK_SIZE][BLOCK_SIZE];
+		// load next block for factorization
+		load_block(diag_block, MATRIX_ARGS(a), diagonal_block,
+				   diagonal_block, a_size);
+
+		// LU factorize the diagonal block
+		lu_factorization_c1(diag_block, diag_block_out, scale_factors,
+													ipvt);
+
+		// Store pivoting information in global memory
+		#pragma unroll GLOBAL_MEM_UNROLL
+		for (int i=0; i<BLOCK_SIZE; i++) {
+			pvt[diagonal_block * BLOCK_SIZE + i] =
+							diagonal_block * BLOCK_SIZE + ipvt[i];
+		}
+
+		store_block(diag_block_out, MATRIX_ARGS(a), diagonal_block,
+					diagonal_block, a_size);
+		STAT_ADD(STAT_C1_BLOCKS, 1);
+		STAT_ADD(STAT_STORED_BLOCKS, 1);
+	}
+	else {
+		// The diagonal block was factorized by a previous execution.
+		// The scale factors are the negative inverses of its diagonal.
+		load_block(diag_block_out, MATRIX_ARGS(a), diagonal_block,
+				   diagonal_block, a_size);
+		#pragma unroll
+		for (int i=0; i<BLOCK_SIZE; i++) {
+			scale_factors[i] = -1.0 / diag_block_out[i][i];
+		}
+	}
+	STAT_ADD(STAT_LOADED_BLOCKS, 1);
+	STAT_CYCLES(STAT_C1_CYCLES, c1_start);
+
+#if PANEL_BLOCKS > 0
+	// Without block rows below the diagonal block, the top blocks are
+	// updated on their own for the following executions
+	if (update_top && first_block_row >= row_block_end) {
+		STAT_START(top_start);
+		for (int inner_x_block = diagonal_block + 1;
+			inner_x_block < a_size; inner_x_block++) {
+			DATA_TYPE top_block[BLOCK_SIZE][BLOCK_SIZE];
+			DATA_TYPE top_block_out[BLOCK_SIZE][BLOCK_SIZE];
+			load_block(top_block, MATRIX_ARGS(a), inner_x_block,
+										diagonal_block, a_size);
+			top_blocks_c3(diag_block_out, top_block, top_block_out, ipvt);
+			store_block(top_block_out, MATRIX_ARGS(a), inner_x_block,
+										diagonal_block, a_size);
+		}
+		STAT_ADD(STAT_C3_BLOCKS, a_size - diagonal_block - 1);
+		STAT_ADD(STAT_LOADED_BLOCKS, a_size - diagonal_block - 1);
+		STAT_ADD(STAT_STORED_BLOCKS, a_size - diagonal_block - 1);
+		STAT_CYCLES(STAT_C2_C3_CYCLES, top_start);
+	}
+
+	// Update the left blocks in chunks of PANEL_BLOCKS blocks. The
+	// results of C2 are kept in the on-chip panel buffer and are used
+	// for all inner blocks in the same rows.
+	for (int chunk_start = first_block_row; chunk_start < row_block_end;
+		chunk_start += PANEL_BLOCKS) {
+		int chunk_end = (chunk_start + PANEL_BLOCKS < row_block_end) ?
+							chunk_start + PANEL_BLOCKS : row_block_end;
+		DATA_TYPE left_panel[PANEL_BLOCKS][BLOCK_SIZE][BLOCK_SIZE];
+
+		STAT_START(c2_start);
+		for (int inner_y_block = chunk_start; inner_y_block < chunk_end;
+			inner_y_block++) {
+			DATA_TYPE left_block[BLOCK_SIZE][BLOCK_SIZE];
+			load_block(left_block, MATRIX_ARGS(a), diagonal_block,
+										inner_y_block, a_size);
+			left_blocks_c2(diag_block_out, left_block,
+					left_panel[inner_y_block - chunk_start],
+					scale_factors);
+			store_block(left_panel[inner_y_block - chunk_start],
+							MATRIX_ARGS(a), diagonal_block,
+							inner_y_block, a_size);
+		}
+		STAT_ADD(STAT_C2_BLOCKS, chunk_end - chunk_start);
+		STAT_ADD(STAT_LOADED_BLOCKS, chunk_end - chunk_start);
+		STAT_ADD(STAT_STORED_BLOCKS, chunk_end - chunk_start);
+		STAT_CYCLES(STAT_C2_C3_CYCLES, c2_start);
+
+		// The top blocks of the first chunk are updated in this loop,
+		// so their cycles are counted for C4
+		STAT_START(c4_start);
+
+		for (int inner_x_block = diagonal_block + 1;
+			inner_x_block < a_size; inner_x_block++) {
+			DATA_TYPE top_block_out[BLOCK_SIZE][BLOCK_SIZE];
+			if (update_top && chunk_start == first_block_row) {
+				// The top block is updated with the first chunk and
+				// directly used for the update of the inner blocks
+				DATA_TYPE top_block[BLOCK_SIZE][BLOCK_SIZE];
+				load_block(top_block, MATRIX_ARGS(a), inner_x_block,
+											diagonal_block, a_size);
+				top_blocks_c3(diag_block_out, top_block, top_block_out,
+															ipvt);
+				store_block(top_block_out, MATRIX_ARGS(a), inner_x_block,
+												diagonal_block, a_size);
+				STAT_ADD(STAT_C3_BLOCKS, 1);
+				STAT_ADD(STAT_STORED_BLOCKS, 1);
+			}
+			else {
+				load_block(top_block_out, MATRIX_ARGS(a), inner_x_block,
+												diagonal_block, a_size);
+			}
+
+			// Ping-pong buffers for the inner blocks. The next block is
+			// loaded and the last result is stored while C4 is
+			// calculated for the current block.
+			DATA_TYPE current_block[2][BLOCK_SIZE][BLOCK_SIZE];
+			DATA_TYPE current_block_out[2][BLOCK_SIZE][BLOCK_SIZE];
+
+			load_block(current_block[0], MATRIX_ARGS(a), inner_x_block,
+											chunk_start, a_size);
+
+			MATRIX_IVDEP(a)
+			for (int inner_y_block = chunk_start;
+								inner_y_block < chunk_end; inner_y_block++) {
+				int current = (inner_y_block - chunk_start) & 1;
+
+				for (int i = 0; i < BLOCK_SIZE; i++) {
+					#pragma unroll GLOBAL_MEM_UNROLL
+					for (int j = 0; j < BLOCK_SIZE; j++) {
+						if (inner_y_block + 1 < chunk_end) {
+							current_block[1 - current][i][j] =
+								read_element(MATRIX_ARGS(a),
+									inner_x_block, inner_y_block + 1,
+									i, j, a_size);
+						}
+						if (inner_y_block > chunk_start) {
+							write_element(MATRIX_ARGS(a), inner_x_block,
+									inner_y_block - 1, i, j, a_size,
+									current_block_out[1 - current][i][j]);
+						}
+					}
+				}
+
+				inner_blocks_c4(left_panel[inner_y_block - chunk_start],
+								top_block_out, current_block[current],
+								current_block_out[current]);
+			}
+
+			store_block(current_block_out[(chunk_end - 1 - chunk_start)
+							& 1], MATRIX_ARGS(a), inner_x_block,
+							chunk_end - 1, a_size);
+			STAT_ADD(STAT_C4_BLOCKS, chunk_end - chunk_start);
+			STAT_ADD(STAT_LOADED_BLOCKS, 1 + chunk_end - chunk_start);
+			STAT_ADD(STAT_STORED_BLOCKS, chunk_end - chunk_start);
+		}
+		STAT_CYCLES(STAT_C4_CYCLES, c4_start);
+	}
+#else
+	// Number of block rows below the diagonal block that are updated
+	int rows = row_block_end - first_block_row;
+
+	// For each block below and right of the diagonal block
+	// finish LU factorization and scaling
+	STAT_START(c2_c3_start);
+	for (int inner_block = diagonal_block + 1; inner_block < a_size;
+		inner_block++) {
+		if (update_top) {
+			DATA_TYPE top_block[BLOCK_SIZE][BLOCK_SIZE];
+			DATA_TYPE top_block_out[BLOCK_SIZE][BLOCK_SIZE];
+			load_block(top_block, MATRIX_ARGS(a), inner_block,
+					   diagonal_block, a_size);
+			top_blocks_c3(diag_block_out, top_block, top_block_out, ipvt);
+			store_block(top_block_out, MATRIX_ARGS(a), inner_block,
+										diagonal_block, a_size);
+		}
+		if (inner_block >= first_block_row
+							&& inner_block < row_block_end) {
+			DATA_TYPE left_block[BLOCK_SIZE][BLOCK_SIZE];
+			DATA_TYPE left_block_out[BLOCK_SIZE][BLOCK_SIZE];
+			load_block(left_block, MATRIX_ARGS(a), diagonal_block,
+										inner_block, a_size);
+			left_blocks_c2(diag_block_out, left_block,
+								left_block_out, scale_factors);
+			store_block(left_block_out, MATRIX_ARGS(a), diagonal_block,
+										inner_block, a_size);
+		}
+	}
+	if (update_top) {
+		STAT_ADD(STAT_C3_BLOCKS, a_size - diagonal_block - 1);
+		STAT_ADD(STAT_LOADED_BLOCKS, a_size - diagonal_block - 1);
+		STAT_ADD(STAT_STORED_BLOCKS, a_size - diagonal_block - 1);
+	}
+	STAT_ADD(STAT_C2_BLOCKS, rows);
+	STAT_ADD(STAT_LOADED_BLOCKS, rows);
+	STAT_ADD(STAT_STORED_BLOCKS, rows);
+	STAT_CYCLES(STAT_C2_C3_CYCLES, c2_c3_start);
+
+	// Update all remaining blocks of the block rows
+	STAT_START(c4_start);
+	for (int inner_x_block = diagonal_block + 1; inner_x_block < a_size
+				&& first_block_row < row_block_end; inner_x_block++) {
+
+		DATA_TYPE top_block_out[BLOCK_SIZE][BLOCK_SIZE];
+		load_block(top_block_out, MATRIX_ARGS(a), inner_x_block,
+				   diagonal_block, a_size);
+
+		// Ping-pong buffers for the left and inner blocks. The next
+		// blocks are loaded and the last result is stored while C4 is
+		// calculated for the current block.
+		DATA_TYPE left_block_out[2][BLOCK_SIZE][BLOCK_SIZE];
+		DATA_TYPE current_block[2][BLOCK_SIZE][BLOCK_SIZE];
+		DATA_TYPE current_block_out[2][BLOCK_SIZE][BLOCK_SIZE];
+
+		load_block(left_block_out[0], MATRIX_ARGS(a), diagonal_block,
+									first_block_row, a_size);
+		load_block(current_block[0], MATRIX_ARGS(a), inner_x_block,
+									first_block_row, a_size);
+
+		MATRIX_IVDEP(a)
+		for (int inner_y_block = first_block_row;
+					inner_y_block < row_block_end; inner_y_block++) {
+			int current = (inner_y_block - first_block_row) & 1;
+
+			for (int i = 0; i < BLOCK_SIZE; i++) {
+				#pragma unroll GLOBAL_MEM_UNROLL
+				for (int j = 0; j < BLOCK_SIZE; j++) {
+					if (inner_y_block + 1 < row_block_end) {
+						left_block_out[1 - current][i][j] =
+							read_element(MATRIX_ARGS(a), diagonal_block,
+								inner_y_block + 1, i, j, a_size);
+						current_block[1 - current][i][j] =
+							read_element(MATRIX_ARGS(a), inner_x_block,
+								inner_y_block + 1, i, j, a_size);
+					}
+					if (inner_y_block > first_block_row) {
+						write_element(MATRIX_ARGS(a), inner_x_block,
+								inner_y_block - 1, i, j, a_size,
+								current_block_out[1 - current][i][j]);
+					}
+				}
+			}
+
+			inner_blocks_c4(left_block_out[current], top_block_out,
+							current_block[current],
+							current_block_out[current]);
+		}
+
+		store_block(current_block_out[(row_block_end - 1
+						- first_block_row) & 1], MATRIX_ARGS(a),
+						inner_x_block, row_block_end - 1, a_size);
+		STAT_ADD(STAT_C4_BLOCKS, rows);
+		STAT_ADD(STAT_LOADED_BLOCKS, 1 + 2 * rows);
+		STAT_ADD(STAT_STORED_BLOCKS, rows);
+	}
+	STAT_CYCLES(STAT_C4_CYCLES, c4_start);
+#endif
+}
+
+
+/**
+Solves the linear equations A*x = b using the LU factorization calculated
+by the gefa kernel.
+First L*y = b is solved by applying the pivoting and the multipliers of every
+diagonal block to the corresponding part of b and updating the parts of b
+below it. Then U*x = y is solved block-wise from the bottom to the top.
+
+@param a The data arrays representing the LU factorized matrix in global
+		 memory
+@param b The right-hand side of the equation. Will be overwritten with the
+		 solution x.
+@param pvt Pivoting information calculated by gefa
+@param a_size the x and y size of the matrix in blocks
+*/
+void
+solve_lu(MATRIX_PARAMS(a), global DATA_TYPE* restrict b,
+		 global const int* restrict pvt, uint a_size) {
+
+	// solve l*y = b
+	// For each diagonal block from top to bottom
+	for (int diagonal_block=0; diagonal_block < a_size; diagonal_block++) {
+		DATA_TYPE diag_block[BLOCK_SIZE][BLOCK_SIZE];
+		DATA_TYPE b_block[BLOCK_SIZE];
+		load_block(diag_block, MATRIX_ARGS(a), diagonal_block, diagonal_block,
+				   a_size);
+
+		#pragma unroll GLOBAL_MEM_UNROLL
+		for (int i=0; i < BLOCK_SIZE; i++) {
+			b_block[i] = b[diagonal_block * BLOCK_SIZE + i];
+		}
+
+		// Pivoting is only done within the diagonal block, so all row swaps
+		// can be applied to the local copy of b
+		for (int k=0; k < BLOCK_SIZE; k++) {
+			int pvt_index = pvt[diagonal_block * BLOCK_SIZE + k]
+											- diagonal_block * BLOCK_SIZE;
+			DATA_TYPE b_k = 0;
+			DATA_TYPE b_pvt = 0;
+			#pragma unroll
+			for (int i=0; i < BLOCK_SIZE; i++) {
+				if (i == k) {
+					b_k = b_block[i];
+				}
+				if (i == pvt_index) {
+					b_pvt = b_block[i];
+				}
+			}
+			// Swap the rows and add the scaled pivot row to all rows below
+			#pragma unroll
+			for (int i=0; i < BLOCK_SIZE; i++) {
+				DATA_TYPE b_i = b_block[i];
+				if (i == pvt_index) {
+					b_i = b_k;
+				}
+				if (i == k) {
+					b_i = b_pvt;
+				}
+				if (i > k) {
+					b_i += diag_block[i][k] * b_pvt;
+				}
+				b_block[i] = b_i;
+			}
+		}
+
+		#pragma unroll GLOBAL_MEM_UNROLL
+		for (int i=0; i < BLOCK_SIZE; i++) {
+			b[diagonal_block * BLOCK_SIZE + i] = b_block[i];
+		}
+
+		// Update the parts of b below the diagonal block
+		for (int inner_block = diagonal_block + 1; inner_block < a_size;
+			inner_block++) {
+			DATA_TYPE left_block[BLOCK_SIZE][BLOCK_SIZE];
+			load_block(left_block, MATRIX_ARGS(a), diagonal_block, inner_block,
+					   a_size);
+
+			for (int i=0; i < BLOCK_SIZE; i++) {
+				DATA_TYPE sum = 0;
+				#pragma unroll
+				for (int k=0; k < BLOCK_SIZE; k++) {
+					sum += left_block[i][k] * b_block[k];
+				}
+				b[inner_block * BLOCK_SIZE + i] += sum;
+			}
+		}
+	}
+
+	// now solve u*x = y
+	// For each diagonal block from bottom to top
+	for (int diagonal_block=a_size - 1; diagonal_block >= 0;
+		diagonal_block--) {
+		DATA_TYPE diag_block[BLOCK_SIZE][BLOCK_SIZE];
+		DATA_TYPE b_block[BLOCK_SIZE];
+		load_block(diag_block, MATRIX_ARGS(a), diagonal_block, diagonal_block,
+				   a_size);
+
+		#pragma unroll GLOBAL_MEM_UNROLL
+		for (int i=0; i < BLOCK_SIZE; i++) {
+			b_block[i] = b[diagonal_block * BLOCK_SIZE + i];
+		}
+
+		for (int k=BLOCK_SIZE - 1; k >= 0; k--) {
+			DATA_TYPE b_k = 0;
+			#pragma unroll
+			for (int i=0; i < BLOCK_SIZE; i++) {
+				if (i == k) {
+					b_k = b_block[i];
+				}
+			}
+			DATA_TYPE x_k = b_k / diag_block[k][k];
+			// Subtract the solved row from all rows above
+			#pragma unroll
+			for (int i=0; i < BLOCK_SIZE; i++) {
+				if (i == k) {
+					b_block[i] = x_k;
+				}
+				if (i < k) {
+					b_block[i] -= x_k * diag_block[i][k];
+				}
+			}
+		}
+
+		#pragma unroll GLOBAL_MEM_UNROLL
+		for (int i=0; i < BLOCK_SIZE; i++) {
+			b[diagonal_block * BLOCK_SIZE + i] = b_block[i];
+		}
+
+		// Update the parts of b above the diagonal block
+		for (int inner_block = 0; inner_block < diagonal_block;
+			inner_block++) {
+			DATA_TYPE top_block[BLOCK_SIZE][BLOCK_SIZE];
+			load_block(top_block, MATRIX_ARGS(a), diagonal_block, inner_block,
+					   a_size);
+
+			for (int i=0; i < BLOCK_SIZE; i++) {
+				DATA_TYPE sum = 0;
+				#pragma unroll
+				for (int k=0; k < BLOCK_SIZE; k++) {
+					sum += top_block[i][k] * b_block[k];
+				}
+				b[inner_block * BLOCK_SIZE + i] -= sum;
+			}
+		}
+	}
+}
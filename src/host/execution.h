@@ -33,19 +33,186 @@ SOFTWARE.
 #define BLOCK_SIZE 32
 #endif
 
+#ifndef DATA_TYPE
+#define DATA_TYPE cl_float
+#endif
+
 
 namespace bm_execution {
 
+/**
+Modes that can be used to verify the results of the benchmark
+
+@see bm_execution::ExecutionConfiguration
+*/
+enum class VerificationMode {
+    // Calculate the residual over all rows. The blocked execution will
+    // additionally compare with a factorization on the CPU.
+    full,
+    // Check the LU factorization with random probe vectors and calculate
+    // the residual over a subset of the rows
+    fast
+};
+
+/**
+OpenCL objects that are kept between multiple executions of the benchmark,
+e.g. for a sweep over multiple matrix sizes or the jobs of the solver
+service.
+The buffers are created for the largest matrix size that was calculated so
+far and are only created again for a larger matrix. Smaller matrices use
+the beginning of the buffers.
+The order of the kernels, buffers and queues is defined by the
+implementation of bm_execution::calculate().
+The batch size is the number of matrices the buffers were created for. It is
+only used by the batched kernels.
+
+@see bm_execution::ExecutionConfiguration
+*/
+struct ExecutionResources {
+    std::vector<cl::Kernel> kernels;
+    std::vector<cl::Buffer> buffers;
+    std::vector<cl::CommandQueue> queues;
+    size_t matrixSize;
+    uint batchSize;
+};
+
+/**
+This struct contains all the information and settings that are needed to
+execute the benchmark.
+If the resources are set, the kernels and buffers are reused and
+updated by the execution. Otherwise, they are created for a single execution.
+The batch size is the number of matrices that are factorized and solved with
+a single kernel execution. It is only used by the batched kernels.
+If memory interleaving is disabled, the buffers of a matrix that is
+distributed over multiple memory banks are placed in separate banks.
+In the zero-copy mode, the matrix is generated in and read from mapped
+buffers in host accessible memory instead of being copied from and to arrays
+on the host. It is only used by the blocked_pvt kernel.
+If the number of stream blocks is greater than 0, the matrix is uploaded in
+chunks of this number of block rows and every chunk is factorized as soon as
+it is on the device. It is only used by the blocked_pvt kernel.
+
+@see bm_execution::calculate()
+*/
+struct ExecutionConfiguration {
+    cl::Context context;
+    cl::Device device;
+    cl::Program program;
+    uint repetitions;
+    uint replications;
+    size_t matrixSize;
+    uint blockSize;
+    VerificationMode verificationMode;
+    ulong verificationRows;
+    uint refinementIterations;
+    bool pipelined;
+    uint warmupIterations;
+    uint batchSize;
+    bool useMemInterleaving;
+    bool zeroCopy;
+    uint streamBlocks;
+    std::shared_ptr<ExecutionResources> resources;
+};
+
+/**
+Results of the mixed-precision iterative refinement of the solution.
+The time only contains the refinement steps. The time of the first solve on
+the host is given separately, because the measured times of the kernels
+already contain a solve for most kernel types.
+The error rate is the normalized residual error in double precision as
+defined for HPL.
+
+@see bm_execution::ExecutionResults
+*/
+struct RefinementResults {
+    uint iterations;
+    double time;
+    double solveTime;
+    double errorRate;
+};
+
+/**
+Execution times of the phases of a single repetition in seconds.
+The times are measured on the device with the profiling information of the
+OpenCL events. If the linear equations are solved on the host, the solve
+time is measured on the host.
+
+@see bm_execution::ExecutionResults
+*/
+struct PhaseTimes {
+    // Upload of the matrix and the right-hand side
+    double write;
+    // LU factorization
+    double gefa;
+    // Solving the linear equations
+    double gesl;
+    // Read back of the result and the pivots
+    double read;
+};
+
+/**
+Indices of the counters of the gefa kernel of blocked_pvt if it is built with
+STAGE_COUNTERS=1. The order is the same as of the STAT_* indices in
+lu_blocked_pvt.cl. The cycles of C2 and C3 are measured together, because
+both are calculated in the same loop.
+
+@see bm_execution::ExecutionResults
+*/
+enum StageCounter {
+    c1Blocks,
+    c2Blocks,
+    c3Blocks,
+    c4Blocks,
+    c1Cycles,
+    c2c3Cycles,
+    c4Cycles,
+    totalCycles,
+    loadedBlocks,
+    storedBlocks,
+    stageCounterCount
+};
+
 /**
 This struct is returned by the calculate call and contains the measured
 runtimes and the error rate in the data set after the updates.
+The times contain the execution time of the kernels for every repetition.
+The phases contain the times of all phases of every repetition.
 The error rate is the normalised residual error of the calculation.
+The refinement results are only set, if the solution was refined.
+The number of matrices is the number of matrices that are solved in every
+repetition. It is larger than one only for the batched kernels.
+The stage counters of gefa in the last repetition are indexed by
+bm_execution::StageCounter. They are empty if the kernel is built without
+STAGE_COUNTERS.
 
 @see bm_execution::calculate()
 */
 struct ExecutionResults {
     std::vector<double> times;
     double errorRate;
+    std::shared_ptr<RefinementResults> refinement;
+    std::vector<PhaseTimes> phases;
+    uint matrices;
+    std::vector<cl_ulong> stageCounters;
+};
+
+/**
+Results of the throughput mode, in which multiple independent jobs are kept
+in flight on the device.
+The latencies contain the time from the submission of every job until its
+solution is available on the host in seconds. The time is the wall-clock time
+needed for all jobs. Every job solves the given number of matrices.
+The error rate is the normalised residual error of the last job.
+
+@see bm_execution::throughput()
+*/
+struct ThroughputResults {
+    uint jobs;
+    uint inFlight;
+    uint matrices;
+    double time;
+    std::vector<double> latencies;
+    double errorRate;
 };
 
 /**
@@ -53,22 +220,60 @@ The actual execution of the benchmark.
 This method can be implemented in multiple *.cpp files. This header enables
 simple exchange of the different calculation methods.
 
-@param context OpenCL context used to create needed Buffers and queues
-@param device The OpenCL device that is used to execute the benchmarks
-@param program The OpenCL program containing the kernels
-@param repetitions Number of times the kernels are executed
-@param replications Number of times a kernel is replicated - may be used in
-                    different ways depending on the implementation of this
-                    method
-@param dataSize The size of the data array that may be used for benchmark
-                execution in number of items
-@param blockSize Size of a block that is calculated by the kernel
+@param config The configuration of the execution containing the OpenCL
+              context, device and program and the settings of the benchmark
 
 @return The time measurements and the error rate counted from the executions
 */
 std::shared_ptr<ExecutionResults>
-calculate(cl::Context context, cl::Device device, cl::Program program,
-               uint repetitions, size_t dataSize, uint block_size);
+calculate(std::shared_ptr<ExecutionConfiguration> config);
+
+/**
+Solve the linear equations A*X = B for a given matrix and multiple
+right-hand sides with the kernels.
+The matrix is factorized once and the factorization is used to solve
+every right-hand side. Only the matrix size, the block size and the
+resources of the configuration are used.
+
+@param config The configuration of the execution containing the OpenCL
+              context, device and program and the size of the matrix
+@param a The matrix in row-major order with a row width of the matrix size.
+         It is not modified.
+@param b The right-hand sides stored one after the other. They are
+         overwritten with the solutions.
+@param nrhs The number of right-hand sides in b
+
+@return The times of the phases of the job. The write and read times
+        contain the transfers of all right-hand sides and the solve time
+        the solves of all right-hand sides.
+
+@throws std::runtime_error if an OpenCL call fails
+*/
+PhaseTimes
+solve(std::shared_ptr<ExecutionConfiguration> config, const DATA_TYPE* a,
+      DATA_TYPE* b, uint nrhs);
+
+/**
+Factorize and solve the given number of independent jobs and keep multiple
+of them in flight to measure the sustained throughput of the device.
+Every job slot has its own command queue and device buffers. The uploads,
+kernel executions and read backs of the slots are ordered by their queues
+and events, so the transfers of one job overlap with the kernels of the
+others. A new job is submitted to a slot as soon as the job before it in
+the same slot is completed. The resources of the configuration are not used.
+
+@param config The configuration of the execution containing the OpenCL
+              context, device and program and the size of the matrix
+@param jobs The total number of jobs
+@param inFlight The number of job slots, i.e. the maximum number of jobs
+                that are submitted to the device at the same time
+
+@return The latencies of all jobs, the total time and the error rate of the
+        last job
+*/
+std::shared_ptr<ThroughputResults>
+throughput(std::shared_ptr<ExecutionConfiguration> config, uint jobs,
+           uint inFlight);
 }  // namespace bm_execution
 
 #endif  // SRC_HOST_EXECUTION_H_
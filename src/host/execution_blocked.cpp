@@ -24,9 +24,11 @@ SOFTWARE.
 #include "src/host/execution.h"
 
 /* C++ standard library headers */
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #ifdef DEBUG
@@ -42,17 +44,67 @@ SOFTWARE.
 /* Project's headers */
 #include "src/host/fpga_setup.h"
 #include "src/host/linpack_functionality.h"
+#include "src/host/throughput.h"
 
 namespace bm_execution {
 
+/**
+Create the kernel, buffers and command queues if they are not already
+given by the resources of the configuration.
+The buffers are used for the matrix and are only created again if they are
+too small for the matrix or the number of buffers changes.
+The first queue is used for the computation and the second one for the
+transfers.
+
+@param config The configuration of the execution
+@param bufferCount The number of buffers for the matrix
+
+@return The resources of the configuration or new resources if the
+        configuration does not contain resources
+
+@throws std::runtime_error if an OpenCL call fails
+*/
+static std::shared_ptr<ExecutionResources>
+prepareResources(std::shared_ptr<ExecutionConfiguration> config,
+                 uint bufferCount) {
+    ulong matrixSize = config->matrixSize;
+    int err;
+    std::shared_ptr<ExecutionResources> resources = config->resources;
+    if (!resources) {
+        resources = std::make_shared<ExecutionResources>();
+    }
+    if (resources->queues.empty()) {
+        for (int i = 0; i < 2; i++) {
+            resources->queues.push_back(cl::CommandQueue(config->context,
+                                config->device, CL_QUEUE_PROFILING_ENABLE));
+        }
+    }
+    if (resources->buffers.size() != bufferCount
+                                || resources->matrixSize < matrixSize) {
+        resources->buffers.clear();
+        for (int i = 0; i < bufferCount; i++) {
+            resources->buffers.push_back(cl::Buffer(config->context,
+                                CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*matrixSize*matrixSize));
+        }
+        resources->matrixSize = matrixSize;
+    }
+    if (resources->kernels.empty()) {
+        resources->kernels.push_back(cl::Kernel(config->program, GEFA_KERNEL,
+                                    &err));
+        THROW_CL(err);
+    }
+    return resources;
+}
+
 /*
  Prepare kernels and execute benchmark for the blocked approach
 
  @copydoc bm_execution::calculate()
 */
 std::shared_ptr<ExecutionResults>
-calculate(cl::Context context, cl::Device device, cl::Program program,
-          uint repetitions, ulong matrixSize, uint blockSize) {
+calculate(std::shared_ptr<ExecutionConfiguration> config) {
+    ulong matrixSize = config->matrixSize;
     uint lda = matrixSize;
     DATA_TYPE* a;
     posix_memalign(reinterpret_cast<void**>(&a), 64,
@@ -63,100 +115,332 @@ calculate(cl::Context context, cl::Device device, cl::Program program,
     cl_int* ipvt;
     posix_memalign(reinterpret_cast<void**>(&ipvt), 64,
                   sizeof(cl_int) * matrixSize);
+    // LU factorization that is read back from the device and the solution
+    // that is calculated with it on the host
+    DATA_TYPE* lu;
+    posix_memalign(reinterpret_cast<void**>(&lu), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    DATA_TYPE* x;
+    posix_memalign(reinterpret_cast<void**>(&x), 64,
+                  sizeof(DATA_TYPE)* matrixSize);
 
     for (int i = 0; i < matrixSize; i++) {
         ipvt[i] = i;
     }
 
     DATA_TYPE norma = 0;
-    double ops = (2.0e0*(matrixSize*matrixSize*matrixSize))/
-                 3.0 + 2.0*(matrixSize*matrixSize);
     int err;
 
-    // Create Command queue
-    cl::CommandQueue compute_queue(context, device);
-
-    // Create Buffers for input and output
-    cl::Buffer Buffer_a(context, CL_MEM_READ_WRITE,
-                                        sizeof(DATA_TYPE)*lda*matrixSize);
-
-    // create the kernels
-    cl::Kernel gefakernel(program, GEFA_KERNEL,
-                                    &err);
-    ASSERT_CL(err);
+    // Reuse the kernels, buffers and queues of previous executions, e.g.
+    // during a sweep over matrix sizes.
+    // The pipelined mode uses two buffers, so the next matrix can be
+    // uploaded during the execution.
+    uint bufferCount = config->pipelined ? 2 : 1;
+    std::shared_ptr<ExecutionResources> resources =
+                                    prepareResources(config, bufferCount);
+    cl::CommandQueue compute_queue = resources->queues[0];
+    cl::CommandQueue transfer_queue = resources->queues[1];
+    std::vector<cl::Buffer> Buffer_a = resources->buffers;
+    cl::Kernel gefakernel = resources->kernels[0];
 
 
     // prepare kernels
-    err = gefakernel.setArg(0, Buffer_a);
-    ASSERT_CL(err);
-    err = gefakernel.setArg(1, static_cast<uint>(matrixSize / blockSize));
+    err = gefakernel.setArg(1, static_cast<uint>(matrixSize /
+                                                config->blockSize));
     ASSERT_CL(err);
 
+    // Generate the matrix and upload it to the given buffer.
+    // The time of the upload is stored for every buffer.
+    std::vector<double> writeTimes(bufferCount);
+    auto upload = [&](uint buffer) {
+        matgen(a, lda, matrixSize, b, &norma);
+        std::vector<cl::Event> writeEvents(1);
+        transfer_queue.enqueueWriteBuffer(Buffer_a[buffer], CL_TRUE, 0,
+                                    sizeof(DATA_TYPE)*lda*matrixSize, a,
+                                    nullptr, &writeEvents[0]);
+        transfer_queue.finish();
+        writeTimes[buffer] = fpga_setup::getEventTime(writeEvents);
+    };
+
     /* --- Execute actual benchmark kernels --- */
 
-    double t;
+    // The warm-up repetitions are executed first and are not measured
+    uint iterations = config->warmupIterations + config->repetitions;
     std::vector<double> executionTimes;
-    for (int i = 0; i < repetitions; i++) {
-        matgen(a, lda, matrixSize, b, &norma);
-        compute_queue.enqueueWriteBuffer(Buffer_a, CL_TRUE, 0,
-                                    sizeof(DATA_TYPE)*lda*matrixSize, a);
+    std::vector<PhaseTimes> phaseTimes;
+    for (int i = 0; i < iterations; i++) {
+        uint current = i % bufferCount;
+        if (!config->pipelined || i == 0) {
+            upload(current);
+        }
+        // Prepare the next repetition while the kernel is executed
+        std::thread worker;
+        if (config->pipelined && i + 1 < iterations) {
+            worker = std::thread(upload, (i + 1) % bufferCount);
+        }
+        err = gefakernel.setArg(0, Buffer_a[current]);
+        ASSERT_CL(err);
+        std::vector<cl::Event> gefaEvents(1);
+        std::vector<cl::Event> readEvents(1);
+        compute_queue.enqueueTask(gefakernel, nullptr, &gefaEvents[0]);
+        compute_queue.enqueueReadBuffer(Buffer_a[current], CL_FALSE, 0,
+                                     sizeof(DATA_TYPE)*lda*matrixSize, lu,
+                                     nullptr, &readEvents[0]);
         compute_queue.finish();
+        if (worker.joinable()) {
+            worker.join();
+        }
+
+        // Solve the linear equations on the host. The right-hand side is
+        // the same for all repetitions.
+        std::copy(b, b + matrixSize, x);
         auto t1 = std::chrono::high_resolution_clock::now();
-        compute_queue.enqueueTask(gefakernel);
-        compute_queue.finish();
+        gesl_ref_blocked(lu, x, ipvt, matrixSize, lda, 1, matrixSize);
         auto t2 = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> timespan =
             std::chrono::duration_cast<std::chrono::duration<double>>
                                                                 (t2 - t1);
-        executionTimes.push_back(timespan.count());
+        if (i >= config->warmupIterations) {
+            executionTimes.push_back(fpga_setup::getEventTime(gefaEvents));
+            phaseTimes.push_back(PhaseTimes{writeTimes[current],
+                            fpga_setup::getEventTime(gefaEvents),
+                            timespan.count(),
+                            fpga_setup::getEventTime(readEvents)});
+        }
     }
 
     /* --- Read back results from Device --- */
 
-    compute_queue.enqueueReadBuffer(Buffer_a, CL_TRUE, 0,
-                                     sizeof(DATA_TYPE)*lda*matrixSize, a);
+    // The LU factorization of the last repetition is already read back
+    // and the solution is calculated
 
 #ifdef DEBUG
     for (int i= 0; i < matrixSize; i++) {
         for (int j=0; j < matrixSize; j++) {
-            std::cout << a[i*lda + j] << ", ";
+            std::cout << lu[i*lda + j] << ", ";
         }
         std::cout << std::endl;
     }
     std::cout <<  std::endl;
 #endif
 
-    gesl_ref(a, b, ipvt, matrixSize, matrixSize);
-
     /* --- Check Results --- */
 
-    double error = checkLINPACKresults(b, matrixSize, matrixSize);
+    // The reported error is the larger one of the residual and the check
+    // of the LU factorization
+    ulong checkedRows = 0;
+    double luError = 0.0;
+    if (config->verificationMode == VerificationMode::fast) {
+        luError = checkLUfactorization(lu, ipvt, lda, matrixSize);
+        checkedRows = config->verificationRows;
+    }
 
-    /* Check CPU reference results */
+    double error = std::max(luError, checkLINPACKresults(x, matrixSize,
+                                        matrixSize, checkedRows));
 
-    matgen(a, lda, matrixSize, b, &norma);
-    gefa_ref(a, matrixSize, lda, ipvt);
+    std::shared_ptr<RefinementResults> refinement;
+    if (config->refinementIterations > 0) {
+        refinement = refineSolution(lu, ipvt, lda, matrixSize,
+                                    config->refinementIterations);
+    }
+
+    if (config->verificationMode == VerificationMode::full) {
+        /* Check CPU reference results */
+
+        matgen(a, lda, matrixSize, b, &norma);
+        gefa_ref_blocked(a, matrixSize, lda, ipvt);
 
 #ifdef DEBUG
-    for (int i= 0; i < matrixSize; i++) {
-        for (int j=0; j < matrixSize; j++) {
-            std::cout << a[i*lda + j] << ", ";
+        for (int i= 0; i < matrixSize; i++) {
+            for (int j=0; j < matrixSize; j++) {
+                std::cout << a[i*lda + j] << ", ";
+            }
+            std::cout << std::endl;
         }
-        std::cout << std::endl;
-    }
-    std::cout <<  std::endl;
+        std::cout <<  std::endl;
 #endif
 
-    gesl_ref(a, b, ipvt, matrixSize, matrixSize);
-    checkLINPACKresults(b, matrixSize, matrixSize);
+        gesl_ref_blocked(a, b, ipvt, matrixSize, lda, 1, matrixSize);
+        checkLINPACKresults(b, matrixSize, matrixSize, 0);
+    }
 
     free(reinterpret_cast<void *>(a));
     free(reinterpret_cast<void *>(b));
     free(reinterpret_cast<void *>(ipvt));
+    free(reinterpret_cast<void *>(lu));
+    free(reinterpret_cast<void *>(x));
 
     std::shared_ptr<ExecutionResults> results(
                     new ExecutionResults{executionTimes,
-                                         error});
+                                         error, refinement, phaseTimes, 1,
+                                         std::vector<cl_ulong>()});
+    return results;
+}
+
+/*
+ Factorize the matrix on the device and solve all right-hand sides on the
+ host
+
+ @copydoc bm_execution::solve()
+*/
+PhaseTimes
+solve(std::shared_ptr<ExecutionConfiguration> config, const DATA_TYPE* a,
+      DATA_TYPE* b, uint nrhs) {
+    ulong matrixSize = config->matrixSize;
+    uint lda = matrixSize;
+    int err;
+
+    std::shared_ptr<ExecutionResources> resources =
+                                                prepareResources(config, 1);
+    cl::CommandQueue compute_queue = resources->queues[0];
+    cl::Buffer Buffer_a = resources->buffers[0];
+    cl::Kernel gefakernel = resources->kernels[0];
+
+    err = gefakernel.setArg(0, Buffer_a);
+    THROW_CL(err);
+    err = gefakernel.setArg(1, static_cast<uint>(matrixSize /
+                                                config->blockSize));
+    THROW_CL(err);
+
+    DATA_TYPE* lu;
+    posix_memalign(reinterpret_cast<void**>(&lu), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    cl_int* ipvt;
+    posix_memalign(reinterpret_cast<void**>(&ipvt), 64,
+                  sizeof(cl_int) * matrixSize);
+    for (int i = 0; i < matrixSize; i++) {
+        ipvt[i] = i;
+    }
+
+    std::vector<cl::Event> writeEvents(1);
+    std::vector<cl::Event> gefaEvents(1);
+    std::vector<cl::Event> readEvents(1);
+    // If a command fails, the queue is finished before the host buffers are
+    // freed, because the enqueued read may still access them
+    try {
+        err = compute_queue.enqueueWriteBuffer(Buffer_a, CL_FALSE, 0,
+                                    sizeof(DATA_TYPE)*lda*matrixSize, a,
+                                    nullptr, &writeEvents[0]);
+        THROW_CL(err);
+        err = compute_queue.enqueueTask(gefakernel, nullptr,
+                                        &gefaEvents[0]);
+        THROW_CL(err);
+        err = compute_queue.enqueueReadBuffer(Buffer_a, CL_FALSE, 0,
+                                    sizeof(DATA_TYPE)*lda*matrixSize, lu,
+                                    nullptr, &readEvents[0]);
+        THROW_CL(err);
+        err = compute_queue.finish();
+        THROW_CL(err);
+    } catch (...) {
+        compute_queue.finish();
+        free(reinterpret_cast<void *>(lu));
+        free(reinterpret_cast<void *>(ipvt));
+        throw;
+    }
+
+    // All right-hand sides are solved on the host with the factorization
+    auto t1 = std::chrono::high_resolution_clock::now();
+    gesl_ref_blocked(lu, b, ipvt, matrixSize, lda, nrhs, matrixSize);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> timespan =
+        std::chrono::duration_cast<std::chrono::duration<double>>
+                                                            (t2 - t1);
+
+    free(reinterpret_cast<void *>(lu));
+    free(reinterpret_cast<void *>(ipvt));
+
+    return PhaseTimes{fpga_setup::getEventTime(writeEvents),
+                      fpga_setup::getEventTime(gefaEvents),
+                      timespan.count(),
+                      fpga_setup::getEventTime(readEvents)};
+}
+
+
+/*
+ Keep multiple factorizations in flight with one queue and one buffer per
+ slot. The linear equations of a completed job are solved on the host.
+
+ @copydoc bm_execution::throughput()
+*/
+std::shared_ptr<ThroughputResults>
+throughput(std::shared_ptr<ExecutionConfiguration> config, uint jobs,
+           uint inFlight) {
+    ulong matrixSize = config->matrixSize;
+    uint lda = matrixSize;
+    int err;
+
+    // All jobs solve the same generated matrix, so it is only generated once
+    DATA_TYPE* a;
+    posix_memalign(reinterpret_cast<void**>(&a), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    DATA_TYPE* b;
+    posix_memalign(reinterpret_cast<void**>(&b), 64,
+                  sizeof(DATA_TYPE)* matrixSize);
+    cl_int* ipvt;
+    posix_memalign(reinterpret_cast<void**>(&ipvt), 64,
+                  sizeof(cl_int) * matrixSize);
+    // LU factorizations and solutions of the last job of every slot
+    DATA_TYPE* lu;
+    posix_memalign(reinterpret_cast<void**>(&lu), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize*inFlight);
+    DATA_TYPE* x;
+    posix_memalign(reinterpret_cast<void**>(&x), 64,
+                  sizeof(DATA_TYPE)* matrixSize * inFlight);
+    for (int i = 0; i < matrixSize; i++) {
+        ipvt[i] = i;
+    }
+    DATA_TYPE norma = 0;
+    matgen(a, lda, matrixSize, b, &norma);
+
+    // The kernel arguments are copied when a kernel is enqueued, so the
+    // kernel can be shared between the slots
+    cl::Kernel gefakernel(config->program, GEFA_KERNEL, &err);
+    ASSERT_CL(err);
+    err = gefakernel.setArg(1, static_cast<uint>(matrixSize /
+                                                config->blockSize));
+    ASSERT_CL(err);
+    std::vector<cl::CommandQueue> queues;
+    std::vector<cl::Buffer> Buffer_a;
+    for (uint slot = 0; slot < inFlight; slot++) {
+        queues.push_back(cl::CommandQueue(config->context, config->device,
+                                          CL_QUEUE_PROFILING_ENABLE));
+        Buffer_a.push_back(cl::Buffer(config->context, CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*lda*matrixSize));
+    }
+
+    auto enqueueJob = [&](uint slot) {
+        std::vector<cl::Event> events(3);
+        queues[slot].enqueueWriteBuffer(Buffer_a[slot], CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*lda*matrixSize, a,
+                                nullptr, &events[0]);
+        err = gefakernel.setArg(0, Buffer_a[slot]);
+        ASSERT_CL(err);
+        queues[slot].enqueueTask(gefakernel, nullptr, &events[1]);
+        queues[slot].enqueueReadBuffer(Buffer_a[slot], CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*lda*matrixSize,
+                                lu + slot * lda * matrixSize, nullptr,
+                                &events[2]);
+        queues[slot].flush();
+        return events;
+    };
+    auto completeJob = [&](uint slot) {
+        std::copy(b, b + matrixSize, x + slot * matrixSize);
+        gesl_ref_blocked(lu + slot * lda * matrixSize, x + slot * matrixSize,
+                         ipvt, matrixSize, lda, 1, matrixSize);
+    };
+
+    std::shared_ptr<ThroughputResults> results =
+                        scheduleJobs(jobs, inFlight, enqueueJob, completeJob);
+
+    results->errorRate = checkLINPACKresults(
+                            x + ((jobs - 1) % inFlight) * matrixSize,
+                            matrixSize, matrixSize, 0);
+
+    free(reinterpret_cast<void *>(a));
+    free(reinterpret_cast<void *>(b));
+    free(reinterpret_cast<void *>(ipvt));
+    free(reinterpret_cast<void *>(lu));
+    free(reinterpret_cast<void *>(x));
     return results;
 }
 
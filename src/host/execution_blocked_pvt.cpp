@@ -24,9 +24,10 @@ SOFTWARE.
 #include "src/host/execution.h"
 
 /* C++ standard library headers */
-#include <chrono>
+#include <algorithm>
 #include <fstream>
 #include <memory>
+#include <thread>
 #include <vector>
 
 /* External library headers */
@@ -38,101 +39,842 @@ SOFTWARE.
 /* Project's headers */
 #include "src/host/fpga_setup.h"
 #include "src/host/linpack_functionality.h"
+#include "src/host/throughput.h"
 
 namespace bm_execution {
 
+/**
+Memory flags of the buffer of the given memory bank.
+If memory interleaving is disabled, every buffer is placed in its own memory
+bank. This requires a kernel that is compiled with -no-interleaving=default.
+In the zero-copy mode, the buffer is allocated in host accessible memory, so
+it can be mapped without a staging copy.
+
+@param config The configuration of the execution
+@param bank The index of the memory bank
+
+@return The flags that are used to create the buffer
+*/
+static cl_mem_flags
+bankFlags(std::shared_ptr<ExecutionConfiguration> config, uint bank) {
+    cl_mem_flags flags = CL_MEM_READ_WRITE;
+    if (config->zeroCopy) {
+        flags |= CL_MEM_ALLOC_HOST_PTR;
+    }
+#if QUARTUS_MAJOR_VERSION > 18
+    if (!config->useMemInterleaving) {
+        flags |= CL_CHANNEL_1_INTELFPGA * (bank + 1);
+    }
+#endif
+    return flags;
+}
+
+/**
+Create the buffers of a matrix that is distributed over the memory banks.
+Every buffer contains the columns of the blocks that belong to one bank.
+
+@param config The configuration of the execution
+@param buffers The buffers of the banks are appended to this vector
+*/
+static void
+createMatrixBuffers(std::shared_ptr<ExecutionConfiguration> config,
+                    std::vector<cl::Buffer>& buffers) {
+    ulong matrixSize = config->matrixSize;
+    for (uint bank = 0; bank < MEMORY_BANKS; bank++) {
+        buffers.push_back(cl::Buffer(config->context, bankFlags(config, bank),
+                    sizeof(DATA_TYPE)*matrixSize*matrixSize / MEMORY_BANKS));
+    }
+}
+
+/**
+Set the buffers of a matrix that is distributed over the memory banks as the
+first arguments of a kernel.
+
+@param kernel The kernel
+@param buffers The buffers of all matrices
+@param first The index of the buffer of the first bank of the matrix
+
+@throws std::runtime_error if an argument can not be set
+*/
+static void
+setMatrixArgs(cl::Kernel& kernel, const std::vector<cl::Buffer>& buffers,
+              uint first) {
+    for (uint bank = 0; bank < MEMORY_BANKS; bank++) {
+        int err = kernel.setArg(bank, buffers[first + bank]);
+        THROW_CL(err);
+    }
+}
+
+/**
+Enqueue the transfer of a matrix in the bank layout to the buffers of the
+memory banks.
+
+@param queue The queue that is used for the transfers
+@param buffers The buffers of all matrices
+@param first The index of the buffer of the first bank of the matrix
+@param banks The matrix in the bank layout
+@param matrixSize The size of the matrix
+@param blocking If true, the transfers are blocking
+@param events The events of the transfers are appended to this vector
+
+@return CL_SUCCESS or the error code of the first transfer that could not
+        be enqueued
+
+@see convertToBankLayout()
+*/
+static cl_int
+writeMatrix(const cl::CommandQueue& queue,
+            const std::vector<cl::Buffer>& buffers, uint first,
+            const DATA_TYPE* banks, ulong matrixSize, cl_bool blocking,
+            std::vector<cl::Event>& events) {
+    ulong bankSize = matrixSize * matrixSize / MEMORY_BANKS;
+    for (uint bank = 0; bank < MEMORY_BANKS; bank++) {
+        events.push_back(cl::Event());
+        cl_int err = queue.enqueueWriteBuffer(buffers[first + bank],
+                                 blocking, 0, sizeof(DATA_TYPE)*bankSize,
+                                 banks + bank * bankSize, nullptr,
+                                 &events.back());
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+    }
+    return CL_SUCCESS;
+}
+
+/**
+Enqueue the transfer of a matrix from the buffers of the memory banks.
+
+@param queue The queue that is used for the transfers
+@param buffers The buffers of all matrices
+@param first The index of the buffer of the first bank of the matrix
+@param banks Buffer for the matrix in the bank layout
+@param matrixSize The size of the matrix
+@param blocking If true, the transfers are blocking
+
+@see convertFromBankLayout()
+*/
+static void
+readMatrix(const cl::CommandQueue& queue,
+           const std::vector<cl::Buffer>& buffers, uint first,
+           DATA_TYPE* banks, ulong matrixSize, cl_bool blocking) {
+    ulong bankSize = matrixSize * matrixSize / MEMORY_BANKS;
+    for (uint bank = 0; bank < MEMORY_BANKS; bank++) {
+        queue.enqueueReadBuffer(buffers[first + bank], blocking, 0,
+                                sizeof(DATA_TYPE)*bankSize,
+                                banks + bank * bankSize);
+    }
+}
+
+/**
+Enqueue the transfer of a range of block rows of a matrix in the bank layout
+from or to the buffers of the memory banks. The block rows are contiguous in
+every bank, so the matrix can be transferred in chunks of block rows.
+
+@param queue The queue that is used for the transfers
+@param buffers The buffers of all matrices
+@param first The index of the buffer of the first bank of the matrix
+@param banks The matrix in the bank layout
+@param matrixSize The size of the matrix
+@param blockSize The size of the blocks
+@param rowStart The first block row that is transferred
+@param rowEnd The block row after the last one that is transferred
+@param write If true, the block rows are written to the buffers. Otherwise,
+                they are read from the buffers.
+@param waitEvents The events the transfers wait for or nullptr
+@param events The events of the transfers are appended to this vector
+*/
+static void
+transferBlockRows(const cl::CommandQueue& queue,
+                  const std::vector<cl::Buffer>& buffers, uint first,
+                  DATA_TYPE* banks, ulong matrixSize, uint blockSize,
+                  uint rowStart, uint rowEnd, bool write,
+                  const std::vector<cl::Event>* waitEvents,
+                  std::vector<cl::Event>& events) {
+    ulong bankSize = matrixSize * matrixSize / MEMORY_BANKS;
+    ulong rowSize = blockSize * matrixSize / MEMORY_BANKS;
+    ulong offset = rowStart * rowSize;
+    ulong size = (rowEnd - rowStart) * rowSize;
+    for (uint bank = 0; bank < MEMORY_BANKS; bank++) {
+        events.push_back(cl::Event());
+        DATA_TYPE* host = banks + bank * bankSize + offset;
+        if (write) {
+            queue.enqueueWriteBuffer(buffers[first + bank], CL_FALSE,
+                                     sizeof(DATA_TYPE)*offset,
+                                     sizeof(DATA_TYPE)*size, host,
+                                     waitEvents, &events.back());
+        } else {
+            queue.enqueueReadBuffer(buffers[first + bank], CL_FALSE,
+                                    sizeof(DATA_TYPE)*offset,
+                                    sizeof(DATA_TYPE)*size, host,
+                                    waitEvents, &events.back());
+        }
+    }
+}
+
+/**
+Create the kernels, buffers and command queues if they are not already
+given by the resources of the configuration.
+The first buffers are used for the matrix, the next ones for the right-hand
+side and the next one for the pivots. With STAGE_COUNTERS, the last buffer
+contains the counters of gefa. Every matrix is distributed over
+MEMORY_BANKS buffers. The buffers are only created again if they are too
+small for the matrix or the number of buffers changes.
+The first queue is used for the computation and the second one for the
+transfers.
+
+@param config The configuration of the execution
+@param bufferCount The number of buffers for the matrix and the right-hand
+                    side
+
+@return The resources of the configuration or new resources if the
+        configuration does not contain resources
+
+@throws std::runtime_error if an OpenCL call fails
+*/
+static std::shared_ptr<ExecutionResources>
+prepareResources(std::shared_ptr<ExecutionConfiguration> config,
+                 uint bufferCount) {
+    ulong matrixSize = config->matrixSize;
+    int err;
+    std::shared_ptr<ExecutionResources> resources = config->resources;
+    if (!resources) {
+        resources = std::make_shared<ExecutionResources>();
+    }
+    if (resources->queues.empty()) {
+        for (int i = 0; i < 2; i++) {
+            resources->queues.push_back(cl::CommandQueue(config->context,
+                                config->device, CL_QUEUE_PROFILING_ENABLE));
+        }
+    }
+    if (resources->buffers.size()
+                    != (MEMORY_BANKS + 1) * bufferCount + 1 + STAGE_COUNTERS
+                                || resources->matrixSize < matrixSize) {
+        resources->buffers.clear();
+        for (int i = 0; i < bufferCount; i++) {
+            createMatrixBuffers(config, resources->buffers);
+        }
+        for (int i = 0; i < bufferCount; i++) {
+            resources->buffers.push_back(cl::Buffer(config->context,
+                                CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*matrixSize));
+        }
+        resources->buffers.push_back(cl::Buffer(config->context,
+                                CL_MEM_READ_WRITE,
+                                sizeof(cl_int)*matrixSize));
+#if STAGE_COUNTERS
+        resources->buffers.push_back(cl::Buffer(config->context,
+                                CL_MEM_READ_WRITE,
+                                sizeof(cl_ulong)*stageCounterCount));
+#endif
+        resources->matrixSize = matrixSize;
+    }
+    if (resources->kernels.empty()) {
+        resources->kernels.push_back(cl::Kernel(config->program, GEFA_KERNEL,
+                                    &err));
+        THROW_CL(err);
+        resources->kernels.push_back(cl::Kernel(config->program, GESL_KERNEL,
+                                    &err));
+        THROW_CL(err);
+    }
+    return resources;
+}
+
 /*
  Prepare kernels and execute benchmark
 
  @copydoc bm_execution::calculate()
 */
 std::shared_ptr<ExecutionResults>
-calculate(cl::Context context, cl::Device device, cl::Program program,
-               uint repetitions, ulong matrixSize, uint blockSize) {
+calculate(std::shared_ptr<ExecutionConfiguration> config) {
+    ulong matrixSize = config->matrixSize;
     uint lda = matrixSize;
-    DATA_TYPE* a;
-    posix_memalign(reinterpret_cast<void**>(&a), 64,
-                  sizeof(DATA_TYPE)*lda*matrixSize);
+    uint aSize = matrixSize / config->blockSize;
+    // In the zero-copy mode, the matrix is generated in the mapped buffers.
+    // The matrix on the host is then only needed for the tile layout.
+    DATA_TYPE* a = nullptr;
+    if (!config->zeroCopy || TILE_LAYOUT) {
+        posix_memalign(reinterpret_cast<void**>(&a), 64,
+                      sizeof(DATA_TYPE)*lda*matrixSize);
+    }
     DATA_TYPE* b;
     posix_memalign(reinterpret_cast<void**>(&b), 64,
                   sizeof(DATA_TYPE)* matrixSize);
     cl_int* ipvt;
     posix_memalign(reinterpret_cast<void**>(&ipvt), 64,
                   sizeof(cl_int) * matrixSize);
+    // Solution of the linear equations that is read back from the device
+    DATA_TYPE* x;
+    posix_memalign(reinterpret_cast<void**>(&x), 64,
+                  sizeof(DATA_TYPE)* matrixSize);
 
     for (int i = 0; i < matrixSize; i++) {
         ipvt[i] = i;
     }
 
+    // Matrix in the layout that is used by the kernels
+    DATA_TYPE* a_device = a;
+#if TILE_LAYOUT
+    if (!config->zeroCopy) {
+        posix_memalign(reinterpret_cast<void**>(&a_device), 64,
+                      sizeof(DATA_TYPE)*lda*matrixSize);
+    }
+#endif
+    // Matrix distributed over the memory banks
+    DATA_TYPE* a_banks = a_device;
+#if MEMORY_BANKS > 1
+    posix_memalign(reinterpret_cast<void**>(&a_banks), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+#endif
+
     DATA_TYPE norma = 0;
-    double ops = (2.0e0*(matrixSize*matrixSize*matrixSize))/
-                 3.0 + 2.0*(matrixSize*matrixSize);
     int err;
 
-    // Create Command queue
-    cl::CommandQueue compute_queue(context, device);
+    // Reuse the kernels, buffers and queues of previous executions, e.g.
+    // during a sweep over matrix sizes.
+    // The pipelined mode uses two buffers for the matrix and the right-hand
+    // side, so the next ones can be uploaded during the execution.
+    uint bufferCount = config->pipelined ? 2 : 1;
+    std::shared_ptr<ExecutionResources> resources =
+                                    prepareResources(config, bufferCount);
+    cl::CommandQueue compute_queue = resources->queues[0];
+    cl::CommandQueue transfer_queue = resources->queues[1];
+    std::vector<cl::Buffer> Buffer_a(resources->buffers.begin(),
+                    resources->buffers.begin() + MEMORY_BANKS * bufferCount);
+    std::vector<cl::Buffer> Buffer_b(
+                    resources->buffers.begin() + MEMORY_BANKS * bufferCount,
+                    resources->buffers.begin()
+                                    + (MEMORY_BANKS + 1) * bufferCount);
+    cl::Buffer Buffer_pivot =
+                    resources->buffers[(MEMORY_BANKS + 1) * bufferCount];
+    cl::Kernel gefakernel = resources->kernels[0];
+    cl::Kernel geslkernel = resources->kernels[1];
 
-    // Create Buffers for input and output
-    cl::Buffer Buffer_a(context, CL_MEM_READ_WRITE,
-                                        sizeof(DATA_TYPE)*lda*matrixSize);
-    cl::Buffer Buffer_pivot(context, CL_MEM_READ_WRITE,
-                                        sizeof(cl_int)*matrixSize);
 
-    // create the kernels
-    cl::Kernel gefakernel(program, GEFA_KERNEL,
-                                    &err);
+    // prepare kernels. The first arguments are the buffers of the banks.
+    // Without streaming, gefa factorizes all block rows at once.
+    err = gefakernel.setArg(MEMORY_BANKS, Buffer_pivot);
     ASSERT_CL(err);
-
-
-    // prepare kernels
-    err = gefakernel.setArg(0, Buffer_a);
+    err = gefakernel.setArg(MEMORY_BANKS + 1, aSize);
+    ASSERT_CL(err);
+    err = gefakernel.setArg(MEMORY_BANKS + 2, 0u);
+    ASSERT_CL(err);
+    err = gefakernel.setArg(MEMORY_BANKS + 3, aSize);
     ASSERT_CL(err);
-    err = gefakernel.setArg(1, Buffer_pivot);
+    err = geslkernel.setArg(MEMORY_BANKS + 1, Buffer_pivot);
     ASSERT_CL(err);
-    err = gefakernel.setArg(2, static_cast<uint>(matrixSize / blockSize));
+    err = geslkernel.setArg(MEMORY_BANKS + 2, aSize);
     ASSERT_CL(err);
+    // The counters of gefa are collected for the last repetition
+    std::vector<cl_ulong> stageCounters;
+#if STAGE_COUNTERS
+    cl::Buffer Buffer_stats = resources->buffers.back();
+    err = gefakernel.setArg(MEMORY_BANKS + 4, Buffer_stats);
+    ASSERT_CL(err);
+    stageCounters.resize(stageCounterCount);
+#endif
+
+    // Generate the matrix in the layout that is used by the kernels
+    auto generate = [&]() {
+        matgen(a, lda, matrixSize, b, &norma);
+#if TILE_LAYOUT
+        convertToTileLayout(a, a_device, matrixSize, lda, config->blockSize);
+#endif
+#if MEMORY_BANKS > 1
+        convertToBankLayout(a_device, a_banks, matrixSize, config->blockSize,
+                            MEMORY_BANKS);
+#endif
+    };
+
+    // Generate the matrix and upload it to the given buffers.
+    // The time of the upload is stored for every buffer. In the zero-copy
+    // mode, this is the time to map and unmap the buffer of the matrix.
+    // The old content of the buffer is invalidated by the mapping, so it
+    // does not have to be copied to the host.
+    // In the pipelined mode, the upload runs in a worker thread, so it uses
+    // its own error code.
+    std::vector<double> writeTimes(bufferCount);
+    auto upload = [&](uint buffer) {
+        std::vector<cl::Event> writeEvents(1);
+        if (config->zeroCopy) {
+            cl_int uploadErr;
+            // Only used with a single memory bank
+            writeEvents.push_back(cl::Event());
+            DATA_TYPE* mapped = static_cast<DATA_TYPE*>(
+                        transfer_queue.enqueueMapBuffer(
+                                Buffer_a[buffer * MEMORY_BANKS], CL_TRUE,
+                                CL_MAP_WRITE_INVALIDATE_REGION, 0,
+                                sizeof(DATA_TYPE)*lda*matrixSize,
+                                nullptr, &writeEvents.back(), &uploadErr));
+            ASSERT_CL(uploadErr);
+#if TILE_LAYOUT
+            matgen(a, lda, matrixSize, b, &norma);
+            convertToTileLayout(a, mapped, matrixSize, lda,
+                                config->blockSize);
+#else
+            matgen(mapped, lda, matrixSize, b, &norma);
+#endif
+            writeEvents.push_back(cl::Event());
+            uploadErr = transfer_queue.enqueueUnmapMemObject(
+                                Buffer_a[buffer * MEMORY_BANKS], mapped,
+                                nullptr, &writeEvents.back());
+            ASSERT_CL(uploadErr);
+        } else {
+            generate();
+            writeMatrix(transfer_queue, Buffer_a, buffer * MEMORY_BANKS,
+                        a_banks, matrixSize, CL_TRUE, writeEvents);
+        }
+        transfer_queue.enqueueWriteBuffer(Buffer_b[buffer], CL_TRUE, 0,
+                                    sizeof(DATA_TYPE)*matrixSize, b,
+                                    nullptr, &writeEvents[0]);
+        transfer_queue.finish();
+        // The matrix is generated between the mapping and the unmapping,
+        // so only the times of the commands are summed up
+        writeTimes[buffer] = config->zeroCopy
+                                ? fpga_setup::getEventTimeSum(writeEvents)
+                                : fpga_setup::getEventTime(writeEvents);
+    };
+
+    // Generate the matrix and upload it in chunks of block rows to the
+    // first buffer. The factorization of every chunk waits only for its
+    // upload, so it is executed while the next chunks are transferred.
+    // If readBack is true, every chunk is read back as soon as it is
+    // factorized. Returns the events of the factorization of all chunks.
+    std::vector<cl::Event> streamWriteEvents;
+    auto stream = [&](bool readBack) {
+        generate();
+        streamWriteEvents = std::vector<cl::Event>(1);
+        // The right-hand side is written first, so it is already on the
+        // device when the last chunk is factorized
+        transfer_queue.enqueueWriteBuffer(Buffer_b[0], CL_FALSE, 0,
+                                    sizeof(DATA_TYPE)*matrixSize, b,
+                                    nullptr, &streamWriteEvents[0]);
+        std::vector<cl::Event> gefaEvents;
+        for (uint start = 0; start < aSize; start += config->streamBlocks) {
+            uint end = std::min(start + config->streamBlocks, aSize);
+            std::vector<cl::Event> chunkEvents;
+            transferBlockRows(transfer_queue, Buffer_a, 0, a_banks,
+                              matrixSize, config->blockSize, start, end,
+                              true, nullptr, chunkEvents);
+            transfer_queue.flush();
+            err = gefakernel.setArg(MEMORY_BANKS + 2, start);
+            ASSERT_CL(err);
+            err = gefakernel.setArg(MEMORY_BANKS + 3, end);
+            ASSERT_CL(err);
+            gefaEvents.push_back(cl::Event());
+            compute_queue.enqueueTask(gefakernel, &chunkEvents,
+                                      &gefaEvents.back());
+            compute_queue.flush();
+            streamWriteEvents.insert(streamWriteEvents.end(),
+                                     chunkEvents.begin(), chunkEvents.end());
+        }
+        // The reads are enqueued after all uploads, so they do not block
+        // the uploads in the in-order transfer queue
+        for (uint chunk = 0; readBack && chunk < gefaEvents.size();
+                chunk++) {
+            uint start = chunk * config->streamBlocks;
+            uint end = std::min(start + config->streamBlocks, aSize);
+            std::vector<cl::Event> waitEvents{gefaEvents[chunk]};
+            std::vector<cl::Event> readEvents;
+            transferBlockRows(transfer_queue, Buffer_a, 0, a_banks,
+                              matrixSize, config->blockSize, start, end,
+                              false, &waitEvents, readEvents);
+        }
+        transfer_queue.flush();
+        return gefaEvents;
+    };
 
     /* --- Execute actual benchmark kernels --- */
 
-    double t;
+    // The warm-up repetitions are executed first and are not measured
+    uint iterations = config->warmupIterations + config->repetitions;
+    bool readLU = config->verificationMode == VerificationMode::fast
+                                || config->refinementIterations > 0;
     std::vector<double> executionTimes;
-    for (int i = 0; i < repetitions; i++) {
-        matgen(a, lda, matrixSize, b, &norma);
-        compute_queue.enqueueWriteBuffer(Buffer_a, CL_TRUE, 0,
-                                    sizeof(DATA_TYPE)*lda*matrixSize, a);
-        compute_queue.finish();
-        auto t1 = std::chrono::high_resolution_clock::now();
-        compute_queue.enqueueTask(gefakernel);
+    std::vector<PhaseTimes> phaseTimes;
+    for (int i = 0; i < iterations; i++) {
+        uint current = i % bufferCount;
+        if (config->streamBlocks == 0 && (!config->pipelined || i == 0)) {
+            upload(current);
+        }
+        // Prepare the next repetition while the kernels are executed
+        std::thread worker;
+        if (config->pipelined && i + 1 < iterations) {
+            worker = std::thread(upload, (i + 1) % bufferCount);
+        }
+        setMatrixArgs(gefakernel, Buffer_a, current * MEMORY_BANKS);
+        setMatrixArgs(geslkernel, Buffer_a, current * MEMORY_BANKS);
+        err = geslkernel.setArg(MEMORY_BANKS, Buffer_b[current]);
+        ASSERT_CL(err);
+        std::vector<cl::Event> gefaEvents(1);
+        std::vector<cl::Event> geslEvents(1);
+        std::vector<cl::Event> readEvents(2);
+#if STAGE_COUNTERS
+        if (i + 1 == iterations) {
+            // gefa adds to the counters, so they are reset first
+            compute_queue.enqueueWriteBuffer(Buffer_stats, CL_FALSE, 0,
+                                    sizeof(cl_ulong)*stageCounterCount,
+                                    stageCounters.data());
+        }
+#endif
+        if (config->streamBlocks > 0) {
+            // The factorization of the last repetition is read back in
+            // chunks while the remaining chunks are factorized
+            gefaEvents = stream(readLU && i + 1 == iterations);
+        } else {
+            compute_queue.enqueueTask(gefakernel, nullptr, &gefaEvents[0]);
+        }
+        compute_queue.enqueueTask(geslkernel, nullptr, &geslEvents[0]);
+        compute_queue.enqueueReadBuffer(Buffer_b[current], CL_FALSE, 0,
+                                     sizeof(DATA_TYPE)*matrixSize, x,
+                                     nullptr, &readEvents[0]);
+        compute_queue.enqueueReadBuffer(Buffer_pivot, CL_FALSE, 0,
+                                     sizeof(cl_int)*matrixSize, ipvt,
+                                     nullptr, &readEvents[1]);
         compute_queue.finish();
-        auto t2 = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> timespan =
-            std::chrono::duration_cast<std::chrono::duration<double>>
-                                                                (t2 - t1);
-        executionTimes.push_back(timespan.count());
+        if (config->streamBlocks > 0) {
+            transfer_queue.finish();
+            writeTimes[current] = fpga_setup::getEventTime(streamWriteEvents);
+        }
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (i >= config->warmupIterations) {
+            executionTimes.push_back(fpga_setup::getEventTime(
+                            {gefaEvents[0], geslEvents[0]}));
+            phaseTimes.push_back(PhaseTimes{writeTimes[current],
+                            fpga_setup::getEventTime(gefaEvents),
+                            fpga_setup::getEventTime(geslEvents),
+                            fpga_setup::getEventTime(readEvents)});
+        }
     }
 
     /* --- Read back results from Device --- */
 
-    compute_queue.enqueueReadBuffer(Buffer_a, CL_TRUE, 0,
-                                     sizeof(DATA_TYPE)*lda*matrixSize, a);
-    compute_queue.enqueueReadBuffer(Buffer_pivot, CL_TRUE, 0,
-                                     sizeof(cl_int)*matrixSize, ipvt);
+#if STAGE_COUNTERS
+    compute_queue.enqueueReadBuffer(Buffer_stats, CL_TRUE, 0,
+                                    sizeof(cl_ulong)*stageCounterCount,
+                                    stageCounters.data());
+#endif
 
-    // Solve linear equations on CPU
-    // TODO: This has to be done on FPGA
-    gesl_ref(a, b, ipvt, matrixSize, matrixSize);
+    // The solution and the pivots of the last repetition are already read
+    // back. The LU factorization is only needed on the host for the fast
+    // verification and the refinement of the solution.
+    // In the zero-copy mode, the factorization is read in place from the
+    // mapped buffer.
+    // With streaming, it was already read back in chunks.
+    uint last = (iterations - 1) % bufferCount;
+    DATA_TYPE* lu = a;
+    DATA_TYPE* mapped = nullptr;
+    if (readLU) {
+        if (config->zeroCopy) {
+            mapped = static_cast<DATA_TYPE*>(compute_queue.enqueueMapBuffer(
+                                Buffer_a[last * MEMORY_BANKS], CL_TRUE,
+                                CL_MAP_READ, 0,
+                                sizeof(DATA_TYPE)*lda*matrixSize,
+                                nullptr, nullptr, &err));
+            ASSERT_CL(err);
+#if TILE_LAYOUT
+            convertFromTileLayout(mapped, a, matrixSize, lda,
+                                  config->blockSize);
+#else
+            lu = mapped;
+#endif
+        } else {
+            if (config->streamBlocks == 0) {
+                readMatrix(compute_queue, Buffer_a, last * MEMORY_BANKS,
+                           a_banks, matrixSize, CL_TRUE);
+            }
+#if MEMORY_BANKS > 1
+            convertFromBankLayout(a_banks, a_device, matrixSize,
+                                  config->blockSize, MEMORY_BANKS);
+#endif
+#if TILE_LAYOUT
+            convertFromTileLayout(a_device, a, matrixSize, lda,
+                                  config->blockSize);
+#endif
+        }
+    }
 
     /* --- Check Results --- */
 
-    double error = checkLINPACKresults(b, matrixSize, matrixSize);
+    // The reported error is the larger one of the residual and the check
+    // of the LU factorization
+    ulong checkedRows = 0;
+    double luError = 0.0;
+    if (config->verificationMode == VerificationMode::fast) {
+        luError = checkLUfactorization(lu, ipvt, lda, matrixSize);
+        checkedRows = config->verificationRows;
+    }
+
+    double error = std::max(luError, checkLINPACKresults(x, matrixSize,
+                                        matrixSize, checkedRows));
 
+    std::shared_ptr<RefinementResults> refinement;
+    if (config->refinementIterations > 0) {
+        refinement = refineSolution(lu, ipvt, lda, matrixSize,
+                                    config->refinementIterations);
+    }
+
+    if (mapped) {
+        compute_queue.enqueueUnmapMemObject(Buffer_a[last * MEMORY_BANKS],
+                                            mapped);
+        compute_queue.finish();
+    }
     free(reinterpret_cast<void *>(a));
+#if TILE_LAYOUT
+    if (!config->zeroCopy) {
+        free(reinterpret_cast<void *>(a_device));
+    }
+#endif
+#if MEMORY_BANKS > 1
+    free(reinterpret_cast<void *>(a_banks));
+#endif
     free(reinterpret_cast<void *>(b));
     free(reinterpret_cast<void *>(ipvt));
+    free(reinterpret_cast<void *>(x));
 
     std::shared_ptr<ExecutionResults> results(
                     new ExecutionResults{executionTimes,
-                                         error});
+                                         error, refinement, phaseTimes, 1,
+                                         stageCounters});
+    return results;
+}
+
+/*
+ Factorize the matrix on the device and solve all right-hand sides with gesl
+
+ @copydoc bm_execution::solve()
+*/
+PhaseTimes
+solve(std::shared_ptr<ExecutionConfiguration> config, const DATA_TYPE* a,
+      DATA_TYPE* b, uint nrhs) {
+    ulong matrixSize = config->matrixSize;
+    uint aSize = matrixSize / config->blockSize;
+    int err;
+
+    std::shared_ptr<ExecutionResources> resources =
+                                                prepareResources(config, 1);
+    cl::CommandQueue compute_queue = resources->queues[0];
+    cl::Buffer Buffer_b = resources->buffers[MEMORY_BANKS];
+    cl::Buffer Buffer_pivot = resources->buffers[MEMORY_BANKS + 1];
+    cl::Kernel gefakernel = resources->kernels[0];
+    cl::Kernel geslkernel = resources->kernels[1];
+
+    setMatrixArgs(gefakernel, resources->buffers, 0);
+    err = gefakernel.setArg(MEMORY_BANKS, Buffer_pivot);
+    THROW_CL(err);
+    err = gefakernel.setArg(MEMORY_BANKS + 1, aSize);
+    THROW_CL(err);
+    err = gefakernel.setArg(MEMORY_BANKS + 2, 0u);
+    THROW_CL(err);
+    err = gefakernel.setArg(MEMORY_BANKS + 3, aSize);
+    THROW_CL(err);
+#if STAGE_COUNTERS
+    err = gefakernel.setArg(MEMORY_BANKS + 4, resources->buffers.back());
+    THROW_CL(err);
+#endif
+    setMatrixArgs(geslkernel, resources->buffers, 0);
+    err = geslkernel.setArg(MEMORY_BANKS, Buffer_b);
+    THROW_CL(err);
+    err = geslkernel.setArg(MEMORY_BANKS + 1, Buffer_pivot);
+    THROW_CL(err);
+    err = geslkernel.setArg(MEMORY_BANKS + 2, aSize);
+    THROW_CL(err);
+
+    // Matrix in the layout that is used by the kernels
+    const DATA_TYPE* a_device = a;
+#if TILE_LAYOUT
+    DATA_TYPE* a_tiles;
+    posix_memalign(reinterpret_cast<void**>(&a_tiles), 64,
+                  sizeof(DATA_TYPE)*matrixSize*matrixSize);
+    convertToTileLayout(a, a_tiles, matrixSize, matrixSize,
+                        config->blockSize);
+    a_device = a_tiles;
+#endif
+#if MEMORY_BANKS > 1
+    DATA_TYPE* a_banks;
+    posix_memalign(reinterpret_cast<void**>(&a_banks), 64,
+                  sizeof(DATA_TYPE)*matrixSize*matrixSize);
+    convertToBankLayout(a_device, a_banks, matrixSize, config->blockSize,
+                        MEMORY_BANKS);
+    a_device = a_banks;
+#endif
+
+    // The matrix is factorized once and the right-hand sides are solved
+    // one after the other with the same factorization.
+    // If a command fails, the queue is finished before the host buffers are
+    // freed, because the enqueued transfers may still access them.
+    std::vector<cl::Event> writeEvents;
+    std::vector<cl::Event> gefaEvents(1);
+    std::vector<cl::Event> geslEvents(nrhs);
+    std::vector<cl::Event> readEvents(nrhs);
+    try {
+        err = writeMatrix(compute_queue, resources->buffers, 0, a_device,
+                          matrixSize, CL_FALSE, writeEvents);
+        THROW_CL(err);
+        err = compute_queue.enqueueTask(gefakernel, nullptr,
+                                        &gefaEvents[0]);
+        THROW_CL(err);
+        for (int i = 0; i < nrhs; i++) {
+            writeEvents.push_back(cl::Event());
+            err = compute_queue.enqueueWriteBuffer(Buffer_b, CL_FALSE, 0,
+                                    sizeof(DATA_TYPE)*matrixSize,
+                                    b + i * matrixSize, nullptr,
+                                    &writeEvents.back());
+            THROW_CL(err);
+            err = compute_queue.enqueueTask(geslkernel, nullptr,
+                                            &geslEvents[i]);
+            THROW_CL(err);
+            err = compute_queue.enqueueReadBuffer(Buffer_b, CL_FALSE, 0,
+                                    sizeof(DATA_TYPE)*matrixSize,
+                                    b + i * matrixSize, nullptr,
+                                    &readEvents[i]);
+            THROW_CL(err);
+        }
+        err = compute_queue.finish();
+        THROW_CL(err);
+    } catch (...) {
+        compute_queue.finish();
+#if TILE_LAYOUT
+        free(reinterpret_cast<void *>(a_tiles));
+#endif
+#if MEMORY_BANKS > 1
+        free(reinterpret_cast<void *>(a_banks));
+#endif
+        throw;
+    }
+
+#if TILE_LAYOUT
+    free(reinterpret_cast<void *>(a_tiles));
+#endif
+#if MEMORY_BANKS > 1
+    free(reinterpret_cast<void *>(a_banks));
+#endif
+
+    return PhaseTimes{fpga_setup::getEventTimeSum(writeEvents),
+                      fpga_setup::getEventTime(gefaEvents),
+                      fpga_setup::getEventTimeSum(geslEvents),
+                      fpga_setup::getEventTimeSum(readEvents)};
+}
+
+
+/*
+ Keep multiple factorizations and solves in flight with one queue and one
+ set of buffers per slot
+
+ @copydoc bm_execution::throughput()
+*/
+std::shared_ptr<ThroughputResults>
+throughput(std::shared_ptr<ExecutionConfiguration> config, uint jobs,
+           uint inFlight) {
+    ulong matrixSize = config->matrixSize;
+    uint lda = matrixSize;
+    uint aSize = matrixSize / config->blockSize;
+    int err;
+
+    // All jobs solve the same generated matrix, so it is only generated once
+    DATA_TYPE* a;
+    posix_memalign(reinterpret_cast<void**>(&a), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    DATA_TYPE* b;
+    posix_memalign(reinterpret_cast<void**>(&b), 64,
+                  sizeof(DATA_TYPE)* matrixSize);
+    // Solutions of the last job of every slot
+    DATA_TYPE* x;
+    posix_memalign(reinterpret_cast<void**>(&x), 64,
+                  sizeof(DATA_TYPE)* matrixSize * inFlight);
+    DATA_TYPE norma = 0;
+    matgen(a, lda, matrixSize, b, &norma);
+    DATA_TYPE* a_device = a;
+#if TILE_LAYOUT
+    posix_memalign(reinterpret_cast<void**>(&a_device), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    convertToTileLayout(a, a_device, matrixSize, lda, config->blockSize);
+#endif
+    DATA_TYPE* a_banks = a_device;
+#if MEMORY_BANKS > 1
+    posix_memalign(reinterpret_cast<void**>(&a_banks), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    convertToBankLayout(a_device, a_banks, matrixSize, config->blockSize,
+                        MEMORY_BANKS);
+#endif
+
+    // The kernel arguments are copied when a kernel is enqueued, so the
+    // kernels can be shared between the slots
+    cl::Kernel gefakernel(config->program, GEFA_KERNEL, &err);
+    ASSERT_CL(err);
+    cl::Kernel geslkernel(config->program, GESL_KERNEL, &err);
+    ASSERT_CL(err);
+    std::vector<cl::CommandQueue> queues;
+    std::vector<cl::Buffer> Buffer_a;
+    std::vector<cl::Buffer> Buffer_b;
+    std::vector<cl::Buffer> Buffer_pivot;
+    for (uint slot = 0; slot < inFlight; slot++) {
+        queues.push_back(cl::CommandQueue(config->context, config->device,
+                                          CL_QUEUE_PROFILING_ENABLE));
+        createMatrixBuffers(config, Buffer_a);
+        Buffer_b.push_back(cl::Buffer(config->context, CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*matrixSize));
+        Buffer_pivot.push_back(cl::Buffer(config->context, CL_MEM_READ_WRITE,
+                                sizeof(cl_int)*matrixSize));
+    }
+#if STAGE_COUNTERS
+    // The counters are not evaluated in the throughput mode, so all slots
+    // share a single buffer
+    cl::Buffer Buffer_stats(config->context, CL_MEM_READ_WRITE,
+                            sizeof(cl_ulong)*stageCounterCount);
+    err = gefakernel.setArg(MEMORY_BANKS + 4, Buffer_stats);
+    ASSERT_CL(err);
+#endif
+
+    auto enqueueJob = [&](uint slot) {
+        std::vector<cl::Event> events(4);
+        queues[slot].enqueueWriteBuffer(Buffer_b[slot], CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*matrixSize, b,
+                                nullptr, &events[0]);
+        writeMatrix(queues[slot], Buffer_a, slot * MEMORY_BANKS, a_banks,
+                    matrixSize, CL_FALSE, events);
+        setMatrixArgs(gefakernel, Buffer_a, slot * MEMORY_BANKS);
+        err = gefakernel.setArg(MEMORY_BANKS, Buffer_pivot[slot]);
+        ASSERT_CL(err);
+        err = gefakernel.setArg(MEMORY_BANKS + 1, aSize);
+        ASSERT_CL(err);
+        err = gefakernel.setArg(MEMORY_BANKS + 2, 0u);
+        ASSERT_CL(err);
+        err = gefakernel.setArg(MEMORY_BANKS + 3, aSize);
+        ASSERT_CL(err);
+        queues[slot].enqueueTask(gefakernel, nullptr, &events[1]);
+        setMatrixArgs(geslkernel, Buffer_a, slot * MEMORY_BANKS);
+        err = geslkernel.setArg(MEMORY_BANKS, Buffer_b[slot]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(MEMORY_BANKS + 1, Buffer_pivot[slot]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(MEMORY_BANKS + 2, aSize);
+        ASSERT_CL(err);
+        queues[slot].enqueueTask(geslkernel, nullptr, &events[2]);
+        queues[slot].enqueueReadBuffer(Buffer_b[slot], CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*matrixSize,
+                                x + slot * matrixSize, nullptr, &events[3]);
+        queues[slot].flush();
+        return events;
+    };
+
+    std::shared_ptr<ThroughputResults> results =
+                            scheduleJobs(jobs, inFlight, enqueueJob, nullptr);
+
+    results->errorRate = checkLINPACKresults(
+                            x + ((jobs - 1) % inFlight) * matrixSize,
+                            matrixSize, matrixSize, 0);
+
+    free(reinterpret_cast<void *>(a));
+#if TILE_LAYOUT
+    free(reinterpret_cast<void *>(a_device));
+#endif
+#if MEMORY_BANKS > 1
+    free(reinterpret_cast<void *>(a_banks));
+#endif
+    free(reinterpret_cast<void *>(b));
+    free(reinterpret_cast<void *>(x));
     return results;
 }
 
@@ -0,0 +1,574 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Related header files */
+#include "src/host/execution.h"
+
+/* C++ standard library headers */
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/* External library headers */
+#include "CL/cl.hpp"
+#if QUARTUS_MAJOR_VERSION > 18
+#include "CL/cl_ext_intelfpga.h"
+#endif
+
+/* Project's headers */
+#include "src/host/fpga_setup.h"
+#include "src/host/linpack_functionality.h"
+#include "src/host/throughput.h"
+
+namespace bm_execution {
+
+/**
+Create the kernels, buffers and command queues if they are not already
+given by the resources of the configuration.
+The first buffers are used for the matrices, the next ones for the
+right-hand sides and the last one for the pivots of all matrices of the
+batch. The buffers are only created again if they are too small for the
+batch or the number of buffers changes.
+The first queue is used for the computation and the second one for the
+transfers.
+
+@param config The configuration of the execution
+@param bufferCount The number of buffers for the matrices and the
+                    right-hand sides
+@param batch The number of matrices that are stored in the buffers
+
+@return The resources of the configuration or new resources if the
+        configuration does not contain resources
+
+@throws std::runtime_error if an OpenCL call fails
+*/
+static std::shared_ptr<ExecutionResources>
+prepareResources(std::shared_ptr<ExecutionConfiguration> config,
+                 uint bufferCount, uint batch) {
+    ulong matrixSize = config->matrixSize;
+    int err;
+    std::shared_ptr<ExecutionResources> resources = config->resources;
+    if (!resources) {
+        resources = std::make_shared<ExecutionResources>();
+    }
+    if (resources->queues.empty()) {
+        for (int i = 0; i < 2; i++) {
+            resources->queues.push_back(cl::CommandQueue(config->context,
+                                config->device, CL_QUEUE_PROFILING_ENABLE));
+        }
+    }
+    if (resources->buffers.size() != 2 * bufferCount + 1
+                                || resources->matrixSize < matrixSize
+                                || resources->batchSize < batch) {
+        resources->buffers.clear();
+        for (int i = 0; i < bufferCount; i++) {
+            resources->buffers.push_back(cl::Buffer(config->context,
+                                CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*matrixSize*matrixSize*batch));
+        }
+        for (int i = 0; i < bufferCount; i++) {
+            resources->buffers.push_back(cl::Buffer(config->context,
+                                CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*matrixSize*batch));
+        }
+        resources->buffers.push_back(cl::Buffer(config->context,
+                                CL_MEM_READ_WRITE,
+                                sizeof(cl_int)*matrixSize*batch));
+        resources->matrixSize = matrixSize;
+        resources->batchSize = batch;
+    }
+    if (resources->kernels.empty()) {
+        resources->kernels.push_back(cl::Kernel(config->program, GEFA_KERNEL,
+                                    &err));
+        THROW_CL(err);
+        resources->kernels.push_back(cl::Kernel(config->program, GESL_KERNEL,
+                                    &err));
+        THROW_CL(err);
+    }
+    return resources;
+}
+
+/**
+Seed of the generated matrix at a given position of the batch.
+The seeds of two matrices differ by two, so the probe vectors of the fast
+verification, that use the next seed, are never equal to a matrix.
+
+@param matrix Position of the matrix in the batch
+@return The seed that is used to generate the matrix
+*/
+static cl_uint
+matrixSeed(uint matrix) {
+    return MATGEN_SEED + 2 * matrix;
+}
+
+/**
+Generate a different matrix and right-hand side for every entry of the batch
+and store them in the layout that is used by the kernels.
+
+@param a_batch The matrices of the batch in the layout of the kernels
+@param b_batch The right-hand sides of the batch
+@param a Buffer for a single matrix in row-major layout
+@param matrixSize The width and height of the matrices
+@param blockSize The block size that is used by the kernels
+@param batch The number of matrices in the batch
+*/
+static void
+generateBatch(DATA_TYPE* a_batch, DATA_TYPE* b_batch, DATA_TYPE* a,
+              ulong matrixSize, uint blockSize, uint batch) {
+    ulong matrixElements = matrixSize * matrixSize;
+    for (uint m = 0; m < batch; m++) {
+        DATA_TYPE norma = 0;
+        matgen(a, matrixSize, matrixSize, b_batch + m * matrixSize, &norma,
+               matrixSeed(m));
+#if TILE_LAYOUT
+        convertToTileLayout(a, a_batch + m * matrixElements, matrixSize,
+                            matrixSize, blockSize);
+#else
+        std::copy(a, a + matrixElements, a_batch + m * matrixElements);
+#endif
+    }
+}
+
+/**
+The positions of the matrices of a batch that are verified: the first, the
+middle and the last matrix.
+
+@param batch The number of matrices in the batch
+@return The positions in ascending order without duplicates
+*/
+static std::vector<uint>
+verifiedMatrices(uint batch) {
+    std::vector<uint> matrices = {0, batch / 2, batch - 1};
+    matrices.erase(std::unique(matrices.begin(), matrices.end()),
+                   matrices.end());
+    return matrices;
+}
+
+/*
+ Prepare kernels and execute benchmark for a batch of matrices
+
+ @copydoc bm_execution::calculate()
+*/
+std::shared_ptr<ExecutionResults>
+calculate(std::shared_ptr<ExecutionConfiguration> config) {
+    ulong matrixSize = config->matrixSize;
+    uint lda = matrixSize;
+    uint batch = config->batchSize;
+    ulong matrixElements = static_cast<ulong>(lda) * matrixSize;
+    DATA_TYPE* a;
+    posix_memalign(reinterpret_cast<void**>(&a), 64,
+                  sizeof(DATA_TYPE)*matrixElements);
+    // All matrices and right-hand sides of the batch in the layout that is
+    // used by the kernels
+    DATA_TYPE* a_batch;
+    posix_memalign(reinterpret_cast<void**>(&a_batch), 64,
+                  sizeof(DATA_TYPE)*matrixElements*batch);
+    DATA_TYPE* b_batch;
+    posix_memalign(reinterpret_cast<void**>(&b_batch), 64,
+                  sizeof(DATA_TYPE)*matrixSize*batch);
+    cl_int* ipvt;
+    posix_memalign(reinterpret_cast<void**>(&ipvt), 64,
+                  sizeof(cl_int) * matrixSize * batch);
+    // Solutions of the linear equations that are read back from the device
+    DATA_TYPE* x;
+    posix_memalign(reinterpret_cast<void**>(&x), 64,
+                  sizeof(DATA_TYPE)* matrixSize * batch);
+
+    for (int i = 0; i < matrixSize * batch; i++) {
+        ipvt[i] = i % matrixSize;
+    }
+
+    int err;
+
+    uint bufferCount = config->pipelined ? 2 : 1;
+    std::shared_ptr<ExecutionResources> resources =
+                                prepareResources(config, bufferCount, batch);
+    cl::CommandQueue compute_queue = resources->queues[0];
+    cl::CommandQueue transfer_queue = resources->queues[1];
+    std::vector<cl::Buffer> Buffer_a(resources->buffers.begin(),
+                            resources->buffers.begin() + bufferCount);
+    std::vector<cl::Buffer> Buffer_b(resources->buffers.begin() + bufferCount,
+                            resources->buffers.begin() + 2 * bufferCount);
+    cl::Buffer Buffer_pivot = resources->buffers[2 * bufferCount];
+    cl::Kernel gefakernel = resources->kernels[0];
+    cl::Kernel geslkernel = resources->kernels[1];
+
+    // prepare kernels
+    err = gefakernel.setArg(1, Buffer_pivot);
+    ASSERT_CL(err);
+    err = gefakernel.setArg(2, static_cast<uint>(matrixSize /
+                                                config->blockSize));
+    ASSERT_CL(err);
+    err = gefakernel.setArg(3, batch);
+    ASSERT_CL(err);
+    err = geslkernel.setArg(2, Buffer_pivot);
+    ASSERT_CL(err);
+    err = geslkernel.setArg(3, static_cast<uint>(matrixSize /
+                                                config->blockSize));
+    ASSERT_CL(err);
+    err = geslkernel.setArg(4, batch);
+    ASSERT_CL(err);
+
+    // Generate the matrices and upload them to the given buffers.
+    // Every matrix of the batch is generated with its own seed.
+    std::vector<double> writeTimes(bufferCount);
+    auto upload = [&](uint buffer) {
+        generateBatch(a_batch, b_batch, a, matrixSize, config->blockSize,
+                      batch);
+        std::vector<cl::Event> writeEvents(2);
+        transfer_queue.enqueueWriteBuffer(Buffer_a[buffer], CL_TRUE, 0,
+                                    sizeof(DATA_TYPE)*matrixElements*batch,
+                                    a_batch, nullptr, &writeEvents[0]);
+        transfer_queue.enqueueWriteBuffer(Buffer_b[buffer], CL_TRUE, 0,
+                                    sizeof(DATA_TYPE)*matrixSize*batch,
+                                    b_batch, nullptr, &writeEvents[1]);
+        transfer_queue.finish();
+        writeTimes[buffer] = fpga_setup::getEventTime(writeEvents);
+    };
+
+    /* --- Execute actual benchmark kernels --- */
+
+    // The warm-up repetitions are executed first and are not measured
+    uint iterations = config->warmupIterations + config->repetitions;
+    std::vector<double> executionTimes;
+    std::vector<PhaseTimes> phaseTimes;
+    for (int i = 0; i < iterations; i++) {
+        uint current = i % bufferCount;
+        if (!config->pipelined || i == 0) {
+            upload(current);
+        }
+        // Prepare the next repetition while the kernels are executed
+        std::thread worker;
+        if (config->pipelined && i + 1 < iterations) {
+            worker = std::thread(upload, (i + 1) % bufferCount);
+        }
+        err = gefakernel.setArg(0, Buffer_a[current]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(0, Buffer_a[current]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(1, Buffer_b[current]);
+        ASSERT_CL(err);
+        std::vector<cl::Event> gefaEvents(1);
+        std::vector<cl::Event> geslEvents(1);
+        std::vector<cl::Event> readEvents(2);
+        compute_queue.enqueueTask(gefakernel, nullptr, &gefaEvents[0]);
+        compute_queue.enqueueTask(geslkernel, nullptr, &geslEvents[0]);
+        compute_queue.enqueueReadBuffer(Buffer_b[current], CL_FALSE, 0,
+                                     sizeof(DATA_TYPE)*matrixSize*batch, x,
+                                     nullptr, &readEvents[0]);
+        compute_queue.enqueueReadBuffer(Buffer_pivot, CL_FALSE, 0,
+                                     sizeof(cl_int)*matrixSize*batch, ipvt,
+                                     nullptr, &readEvents[1]);
+        compute_queue.finish();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (i >= config->warmupIterations) {
+            executionTimes.push_back(fpga_setup::getEventTime(
+                            {gefaEvents[0], geslEvents[0]}));
+            phaseTimes.push_back(PhaseTimes{writeTimes[current],
+                            fpga_setup::getEventTime(gefaEvents),
+                            fpga_setup::getEventTime(geslEvents),
+                            fpga_setup::getEventTime(readEvents)});
+        }
+    }
+
+    /* --- Check Results --- */
+
+    // Every matrix of the batch is different, so the first, the middle and
+    // the last matrix are verified and the largest error is reported
+    uint last = (iterations - 1) % bufferCount;
+    auto readLU = [&](uint m) {
+        compute_queue.enqueueReadBuffer(Buffer_a[last], CL_TRUE,
+                        sizeof(DATA_TYPE)*matrixElements*m,
+                        sizeof(DATA_TYPE)*matrixElements, a_batch);
+#if TILE_LAYOUT
+        convertFromTileLayout(a_batch, a, matrixSize, lda,
+                              config->blockSize);
+#else
+        std::copy(a_batch, a_batch + matrixElements, a);
+#endif
+    };
+
+    ulong checkedRows = 0;
+    if (config->verificationMode == VerificationMode::fast) {
+        checkedRows = config->verificationRows;
+    }
+    double error = 0.0;
+    for (uint m : verifiedMatrices(batch)) {
+        if (batch > 1) {
+            std::cout << "Matrix " << m << " of " << batch << ":"
+                      << std::endl;
+        }
+        // The LU factorization is only needed on the host for the fast
+        // verification
+        if (config->verificationMode == VerificationMode::fast) {
+            readLU(m);
+            error = std::max(error, checkLUfactorization(a,
+                                        ipvt + m * matrixSize, lda,
+                                        matrixSize, matrixSeed(m)));
+        }
+        error = std::max(error, checkLINPACKresults(x + m * matrixSize,
+                                        matrixSize, matrixSize, checkedRows,
+                                        matrixSeed(m)));
+    }
+
+    // Only the solution of the first matrix is refined
+    std::shared_ptr<RefinementResults> refinement;
+    if (config->refinementIterations > 0) {
+        readLU(0);
+        refinement = refineSolution(a, ipvt, lda, matrixSize,
+                                    config->refinementIterations,
+                                    matrixSeed(0));
+    }
+
+    free(reinterpret_cast<void *>(a));
+    free(reinterpret_cast<void *>(a_batch));
+    free(reinterpret_cast<void *>(b_batch));
+    free(reinterpret_cast<void *>(ipvt));
+    free(reinterpret_cast<void *>(x));
+
+    std::shared_ptr<ExecutionResults> results(
+                    new ExecutionResults{executionTimes,
+                                         error, refinement, phaseTimes,
+                                         batch, std::vector<cl_ulong>()});
+    return results;
+}
+
+/*
+ Factorize the matrix on the device as a batch of a single matrix and solve
+ all right-hand sides with gesl
+
+ @copydoc bm_execution::solve()
+*/
+PhaseTimes
+solve(std::shared_ptr<ExecutionConfiguration> config, const DATA_TYPE* a,
+      DATA_TYPE* b, uint nrhs) {
+    ulong matrixSize = config->matrixSize;
+    uint lda = matrixSize;
+    uint aSize = matrixSize / config->blockSize;
+    int err;
+
+    std::shared_ptr<ExecutionResources> resources =
+                                            prepareResources(config, 1, 1);
+    cl::CommandQueue compute_queue = resources->queues[0];
+    cl::Buffer Buffer_a = resources->buffers[0];
+    cl::Buffer Buffer_b = resources->buffers[1];
+    cl::Buffer Buffer_pivot = resources->buffers[2];
+    cl::Kernel gefakernel = resources->kernels[0];
+    cl::Kernel geslkernel = resources->kernels[1];
+
+    err = gefakernel.setArg(0, Buffer_a);
+    THROW_CL(err);
+    err = gefakernel.setArg(1, Buffer_pivot);
+    THROW_CL(err);
+    err = gefakernel.setArg(2, aSize);
+    THROW_CL(err);
+    err = gefakernel.setArg(3, static_cast<uint>(1));
+    THROW_CL(err);
+    err = geslkernel.setArg(0, Buffer_a);
+    THROW_CL(err);
+    err = geslkernel.setArg(1, Buffer_b);
+    THROW_CL(err);
+    err = geslkernel.setArg(2, Buffer_pivot);
+    THROW_CL(err);
+    err = geslkernel.setArg(3, aSize);
+    THROW_CL(err);
+    err = geslkernel.setArg(4, static_cast<uint>(1));
+    THROW_CL(err);
+
+    // Matrix in the layout that is used by the kernels
+    const DATA_TYPE* a_device = a;
+#if TILE_LAYOUT
+    DATA_TYPE* a_tiles;
+    posix_memalign(reinterpret_cast<void**>(&a_tiles), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    convertToTileLayout(a, a_tiles, matrixSize, lda, config->blockSize);
+    a_device = a_tiles;
+#endif
+
+    // The matrix is factorized once and the right-hand sides are solved
+    // one after the other with the same factorization.
+    // If a command fails, the queue is finished before the host buffers are
+    // freed, because the enqueued transfers may still access them.
+    std::vector<cl::Event> writeEvents(nrhs + 1);
+    std::vector<cl::Event> gefaEvents(1);
+    std::vector<cl::Event> geslEvents(nrhs);
+    std::vector<cl::Event> readEvents(nrhs);
+    try {
+        err = compute_queue.enqueueWriteBuffer(Buffer_a, CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*lda*matrixSize, a_device,
+                                nullptr, &writeEvents[0]);
+        THROW_CL(err);
+        err = compute_queue.enqueueTask(gefakernel, nullptr,
+                                        &gefaEvents[0]);
+        THROW_CL(err);
+        for (int i = 0; i < nrhs; i++) {
+            err = compute_queue.enqueueWriteBuffer(Buffer_b, CL_FALSE, 0,
+                                    sizeof(DATA_TYPE)*matrixSize,
+                                    b + i * matrixSize, nullptr,
+                                    &writeEvents[i + 1]);
+            THROW_CL(err);
+            err = compute_queue.enqueueTask(geslkernel, nullptr,
+                                            &geslEvents[i]);
+            THROW_CL(err);
+            err = compute_queue.enqueueReadBuffer(Buffer_b, CL_FALSE, 0,
+                                    sizeof(DATA_TYPE)*matrixSize,
+                                    b + i * matrixSize, nullptr,
+                                    &readEvents[i]);
+            THROW_CL(err);
+        }
+        err = compute_queue.finish();
+        THROW_CL(err);
+    } catch (...) {
+        compute_queue.finish();
+#if TILE_LAYOUT
+        free(reinterpret_cast<void *>(a_tiles));
+#endif
+        throw;
+    }
+
+#if TILE_LAYOUT
+    free(reinterpret_cast<void *>(a_tiles));
+#endif
+
+    return PhaseTimes{fpga_setup::getEventTimeSum(writeEvents),
+                      fpga_setup::getEventTimeSum(gefaEvents),
+                      fpga_setup::getEventTimeSum(geslEvents),
+                      fpga_setup::getEventTimeSum(readEvents)};
+}
+
+
+/*
+ Keep multiple batches in flight with one queue and one set of buffers per
+ slot. Every job factorizes and solves a whole batch.
+
+ @copydoc bm_execution::throughput()
+*/
+std::shared_ptr<ThroughputResults>
+throughput(std::shared_ptr<ExecutionConfiguration> config, uint jobs,
+           uint inFlight) {
+    ulong matrixSize = config->matrixSize;
+    uint lda = matrixSize;
+    uint aSize = matrixSize / config->blockSize;
+    uint batch = config->batchSize;
+    ulong matrixElements = static_cast<ulong>(lda) * matrixSize;
+    int err;
+
+    // All jobs factorize the same batch, so the batch is only generated once
+    DATA_TYPE* a;
+    posix_memalign(reinterpret_cast<void**>(&a), 64,
+                  sizeof(DATA_TYPE)*matrixElements);
+    DATA_TYPE* a_batch;
+    posix_memalign(reinterpret_cast<void**>(&a_batch), 64,
+                  sizeof(DATA_TYPE)*matrixElements*batch);
+    DATA_TYPE* b_batch;
+    posix_memalign(reinterpret_cast<void**>(&b_batch), 64,
+                  sizeof(DATA_TYPE)*matrixSize*batch);
+    // Solutions of the last job of every slot
+    DATA_TYPE* x;
+    posix_memalign(reinterpret_cast<void**>(&x), 64,
+                  sizeof(DATA_TYPE)*matrixSize*batch*inFlight);
+    generateBatch(a_batch, b_batch, a, matrixSize, config->blockSize, batch);
+
+    // The kernel arguments are copied when a kernel is enqueued, so the
+    // kernels can be shared between the slots
+    cl::Kernel gefakernel(config->program, GEFA_KERNEL, &err);
+    ASSERT_CL(err);
+    cl::Kernel geslkernel(config->program, GESL_KERNEL, &err);
+    ASSERT_CL(err);
+    std::vector<cl::CommandQueue> queues;
+    std::vector<cl::Buffer> Buffer_a;
+    std::vector<cl::Buffer> Buffer_b;
+    std::vector<cl::Buffer> Buffer_pivot;
+    for (uint slot = 0; slot < inFlight; slot++) {
+        queues.push_back(cl::CommandQueue(config->context, config->device,
+                                          CL_QUEUE_PROFILING_ENABLE));
+        Buffer_a.push_back(cl::Buffer(config->context, CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*matrixElements*batch));
+        Buffer_b.push_back(cl::Buffer(config->context, CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*matrixSize*batch));
+        Buffer_pivot.push_back(cl::Buffer(config->context, CL_MEM_READ_WRITE,
+                                sizeof(cl_int)*matrixSize*batch));
+    }
+
+    auto enqueueJob = [&](uint slot) {
+        std::vector<cl::Event> events(5);
+        queues[slot].enqueueWriteBuffer(Buffer_a[slot], CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*matrixElements*batch,
+                                a_batch, nullptr, &events[0]);
+        queues[slot].enqueueWriteBuffer(Buffer_b[slot], CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*matrixSize*batch, b_batch,
+                                nullptr, &events[1]);
+        err = gefakernel.setArg(0, Buffer_a[slot]);
+        ASSERT_CL(err);
+        err = gefakernel.setArg(1, Buffer_pivot[slot]);
+        ASSERT_CL(err);
+        err = gefakernel.setArg(2, aSize);
+        ASSERT_CL(err);
+        err = gefakernel.setArg(3, batch);
+        ASSERT_CL(err);
+        queues[slot].enqueueTask(gefakernel, nullptr, &events[2]);
+        err = geslkernel.setArg(0, Buffer_a[slot]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(1, Buffer_b[slot]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(2, Buffer_pivot[slot]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(3, aSize);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(4, batch);
+        ASSERT_CL(err);
+        queues[slot].enqueueTask(geslkernel, nullptr, &events[3]);
+        queues[slot].enqueueReadBuffer(Buffer_b[slot], CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*matrixSize*batch,
+                                x + slot * matrixSize * batch, nullptr,
+                                &events[4]);
+        queues[slot].flush();
+        return events;
+    };
+
+    std::shared_ptr<ThroughputResults> results =
+                            scheduleJobs(jobs, inFlight, enqueueJob, nullptr);
+    results->matrices = batch;
+
+    // The first, the middle and the last matrix of the last job are verified
+    DATA_TYPE* x_last = x + ((jobs - 1) % inFlight) * matrixSize * batch;
+    results->errorRate = 0.0;
+    for (uint m : verifiedMatrices(batch)) {
+        results->errorRate = std::max(results->errorRate,
+                        checkLINPACKresults(x_last + m * matrixSize,
+                                            matrixSize, matrixSize, 0,
+                                            matrixSeed(m)));
+    }
+
+    free(reinterpret_cast<void *>(a));
+    free(reinterpret_cast<void *>(a_batch));
+    free(reinterpret_cast<void *>(b_batch));
+    free(reinterpret_cast<void *>(x));
+    return results;
+}
+
+}  // namespace bm_execution
@@ -0,0 +1,641 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Related header files */
+#include "src/host/execution.h"
+
+/* C++ standard library headers */
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* External library headers */
+#include "CL/cl.hpp"
+#if QUARTUS_MAJOR_VERSION > 18
+#include "CL/cl_ext_intelfpga.h"
+#endif
+
+/* Project's headers */
+#include "src/host/fpga_setup.h"
+#include "src/host/linpack_functionality.h"
+#include "src/host/throughput.h"
+
+namespace bm_execution {
+
+/**
+Create the kernels, buffers and command queues if they are not already
+given by the resources of the configuration.
+The kernels are stored in the order read, panel, update, store panel,
+store update and gesl.
+The first buffers are used for the matrix, the next ones for the right-hand
+side and the last one for the pivots. The buffers are only created again if
+they are too small for the matrix or the number of buffers changes.
+The kernels of the LU factorization are connected by channels and have to
+run concurrently, so every kernel gets its own queue. The queues are stored
+in the order compute (read and gesl), panel, update, store panel,
+store update and transfer.
+
+@param config The configuration of the execution
+@param bufferCount The number of buffers for the matrix and the right-hand
+                    side
+
+@return The resources of the configuration or new resources if the
+        configuration does not contain resources
+
+@throws std::runtime_error if an OpenCL call fails
+*/
+static std::shared_ptr<ExecutionResources>
+prepareResources(std::shared_ptr<ExecutionConfiguration> config,
+                 uint bufferCount) {
+    ulong matrixSize = config->matrixSize;
+    int err;
+    std::shared_ptr<ExecutionResources> resources = config->resources;
+    if (!resources) {
+        resources = std::make_shared<ExecutionResources>();
+    }
+    if (resources->queues.empty()) {
+        for (int i = 0; i < 6; i++) {
+            resources->queues.push_back(cl::CommandQueue(config->context,
+                                config->device, CL_QUEUE_PROFILING_ENABLE));
+        }
+    }
+    if (resources->buffers.size() != 2 * bufferCount + 1
+                                || resources->matrixSize < matrixSize) {
+        resources->buffers.clear();
+        for (int i = 0; i < bufferCount; i++) {
+            resources->buffers.push_back(cl::Buffer(config->context,
+                                CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*matrixSize*matrixSize));
+        }
+        for (int i = 0; i < bufferCount; i++) {
+            resources->buffers.push_back(cl::Buffer(config->context,
+                                CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*matrixSize));
+        }
+        resources->buffers.push_back(cl::Buffer(config->context,
+                                CL_MEM_READ_WRITE,
+                                sizeof(cl_int)*matrixSize));
+        resources->matrixSize = matrixSize;
+    }
+    if (resources->kernels.empty()) {
+        std::vector<std::string> kernelNames = {GEFA_KERNEL "_read",
+                        GEFA_KERNEL "_panel", GEFA_KERNEL "_update",
+                        GEFA_KERNEL "_store_panel", GEFA_KERNEL "_store_update",
+                        GESL_KERNEL};
+        for (const std::string& name : kernelNames) {
+            resources->kernels.push_back(cl::Kernel(config->program,
+                                                    name.c_str(), &err));
+            THROW_CL(err);
+        }
+    }
+    return resources;
+}
+
+/*
+ Prepare kernels and execute benchmark
+
+ @copydoc bm_execution::calculate()
+*/
+std::shared_ptr<ExecutionResults>
+calculate(std::shared_ptr<ExecutionConfiguration> config) {
+    ulong matrixSize = config->matrixSize;
+    uint lda = matrixSize;
+    DATA_TYPE* a;
+    posix_memalign(reinterpret_cast<void**>(&a), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    DATA_TYPE* b;
+    posix_memalign(reinterpret_cast<void**>(&b), 64,
+                  sizeof(DATA_TYPE)* matrixSize);
+    cl_int* ipvt;
+    posix_memalign(reinterpret_cast<void**>(&ipvt), 64,
+                  sizeof(cl_int) * matrixSize);
+    // Solution of the linear equations that is read back from the device
+    DATA_TYPE* x;
+    posix_memalign(reinterpret_cast<void**>(&x), 64,
+                  sizeof(DATA_TYPE)* matrixSize);
+
+    for (int i = 0; i < matrixSize; i++) {
+        ipvt[i] = i;
+    }
+
+    // Matrix in the layout that is used by the kernels
+    DATA_TYPE* a_device = a;
+#if TILE_LAYOUT
+    posix_memalign(reinterpret_cast<void**>(&a_device), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+#endif
+
+    DATA_TYPE norma = 0;
+    int err;
+
+    // Reuse the kernels, buffers and queues of previous executions, e.g.
+    // during a sweep over matrix sizes.
+    // The pipelined mode uses two buffers for the matrix and the right-hand
+    // side, so the next ones can be uploaded during the execution.
+    uint bufferCount = config->pipelined ? 2 : 1;
+    std::shared_ptr<ExecutionResources> resources =
+                                    prepareResources(config, bufferCount);
+    cl::CommandQueue compute_queue = resources->queues[0];
+    cl::CommandQueue panel_queue = resources->queues[1];
+    cl::CommandQueue update_queue = resources->queues[2];
+    cl::CommandQueue store_panel_queue = resources->queues[3];
+    cl::CommandQueue store_update_queue = resources->queues[4];
+    cl::CommandQueue transfer_queue = resources->queues[5];
+    std::vector<cl::Buffer> Buffer_a(resources->buffers.begin(),
+                            resources->buffers.begin() + bufferCount);
+    std::vector<cl::Buffer> Buffer_b(resources->buffers.begin() + bufferCount,
+                            resources->buffers.begin() + 2 * bufferCount);
+    cl::Buffer Buffer_pivot = resources->buffers[2 * bufferCount];
+    cl::Kernel readkernel = resources->kernels[0];
+    cl::Kernel panelkernel = resources->kernels[1];
+    cl::Kernel updatekernel = resources->kernels[2];
+    cl::Kernel storepanelkernel = resources->kernels[3];
+    cl::Kernel storeupdatekernel = resources->kernels[4];
+    cl::Kernel geslkernel = resources->kernels[5];
+
+    uint aSize = matrixSize / config->blockSize;
+
+    // prepare kernels
+    err = readkernel.setArg(1, aSize);
+    ASSERT_CL(err);
+    err = panelkernel.setArg(0, Buffer_pivot);
+    ASSERT_CL(err);
+    err = panelkernel.setArg(1, aSize);
+    ASSERT_CL(err);
+    err = updatekernel.setArg(0, aSize);
+    ASSERT_CL(err);
+    err = updatekernel.setArg(1, config->replications);
+    ASSERT_CL(err);
+    err = storepanelkernel.setArg(1, aSize);
+    ASSERT_CL(err);
+    err = storeupdatekernel.setArg(1, aSize);
+    ASSERT_CL(err);
+    err = storeupdatekernel.setArg(2, config->replications);
+    ASSERT_CL(err);
+    err = geslkernel.setArg(2, Buffer_pivot);
+    ASSERT_CL(err);
+    err = geslkernel.setArg(3, aSize);
+    ASSERT_CL(err);
+
+    // Generate the matrix and upload it to the given buffers.
+    // The time of the upload is stored for every buffer.
+    std::vector<double> writeTimes(bufferCount);
+    auto upload = [&](uint buffer) {
+        matgen(a, lda, matrixSize, b, &norma);
+#if TILE_LAYOUT
+        convertToTileLayout(a, a_device, matrixSize, lda, config->blockSize);
+#endif
+        std::vector<cl::Event> writeEvents(2);
+        transfer_queue.enqueueWriteBuffer(Buffer_a[buffer], CL_TRUE, 0,
+                                    sizeof(DATA_TYPE)*lda*matrixSize,
+                                    a_device, nullptr, &writeEvents[0]);
+        transfer_queue.enqueueWriteBuffer(Buffer_b[buffer], CL_TRUE, 0,
+                                    sizeof(DATA_TYPE)*matrixSize, b,
+                                    nullptr, &writeEvents[1]);
+        transfer_queue.finish();
+        writeTimes[buffer] = fpga_setup::getEventTime(writeEvents);
+    };
+
+    /* --- Execute actual benchmark kernels --- */
+
+    // The warm-up repetitions are executed first and are not measured
+    uint iterations = config->warmupIterations + config->repetitions;
+    std::vector<double> executionTimes;
+    std::vector<PhaseTimes> phaseTimes;
+    for (int i = 0; i < iterations; i++) {
+        uint current = i % bufferCount;
+        if (!config->pipelined || i == 0) {
+            upload(current);
+        }
+        // Prepare the next repetition while the kernels are executed
+        std::thread worker;
+        if (config->pipelined && i + 1 < iterations) {
+            worker = std::thread(upload, (i + 1) % bufferCount);
+        }
+        err = readkernel.setArg(0, Buffer_a[current]);
+        ASSERT_CL(err);
+        err = storepanelkernel.setArg(0, Buffer_a[current]);
+        ASSERT_CL(err);
+        err = storeupdatekernel.setArg(0, Buffer_a[current]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(0, Buffer_a[current]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(1, Buffer_b[current]);
+        ASSERT_CL(err);
+        std::vector<cl::Event> gefaEvents(5);
+        std::vector<cl::Event> geslEvents(1);
+        std::vector<cl::Event> readEvents(2);
+        store_update_queue.enqueueTask(storeupdatekernel, nullptr,
+                                       &gefaEvents[0]);
+        store_panel_queue.enqueueTask(storepanelkernel, nullptr,
+                                      &gefaEvents[1]);
+        update_queue.enqueueTask(updatekernel, nullptr, &gefaEvents[2]);
+        panel_queue.enqueueTask(panelkernel, nullptr, &gefaEvents[3]);
+        compute_queue.enqueueTask(readkernel, nullptr, &gefaEvents[4]);
+        store_update_queue.finish();
+        store_panel_queue.finish();
+        update_queue.finish();
+        panel_queue.finish();
+        compute_queue.finish();
+        compute_queue.enqueueTask(geslkernel, nullptr, &geslEvents[0]);
+        compute_queue.enqueueReadBuffer(Buffer_b[current], CL_FALSE, 0,
+                                     sizeof(DATA_TYPE)*matrixSize, x,
+                                     nullptr, &readEvents[0]);
+        compute_queue.enqueueReadBuffer(Buffer_pivot, CL_FALSE, 0,
+                                     sizeof(cl_int)*matrixSize, ipvt,
+                                     nullptr, &readEvents[1]);
+        compute_queue.finish();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (i >= config->warmupIterations) {
+            std::vector<cl::Event> kernelEvents(gefaEvents);
+            kernelEvents.push_back(geslEvents[0]);
+            executionTimes.push_back(fpga_setup::getEventTime(kernelEvents));
+            phaseTimes.push_back(PhaseTimes{writeTimes[current],
+                            fpga_setup::getEventTime(gefaEvents),
+                            fpga_setup::getEventTime(geslEvents),
+                            fpga_setup::getEventTime(readEvents)});
+        }
+    }
+
+    /* --- Read back results from Device --- */
+
+    // The solution and the pivots of the last repetition are already read
+    // back. The LU factorization is only needed on the host for the fast
+    // verification and the refinement of the solution.
+    uint last = (iterations - 1) % bufferCount;
+    if (config->verificationMode == VerificationMode::fast
+                                || config->refinementIterations > 0) {
+        compute_queue.enqueueReadBuffer(Buffer_a[last], CL_TRUE, 0,
+                                     sizeof(DATA_TYPE)*lda*matrixSize,
+                                     a_device);
+#if TILE_LAYOUT
+        convertFromTileLayout(a_device, a, matrixSize, lda,
+                              config->blockSize);
+#endif
+    }
+
+    /* --- Check Results --- */
+
+    // The reported error is the larger one of the residual and the check
+    // of the LU factorization
+    ulong checkedRows = 0;
+    double luError = 0.0;
+    if (config->verificationMode == VerificationMode::fast) {
+        luError = checkLUfactorization(a, ipvt, lda, matrixSize);
+        checkedRows = config->verificationRows;
+    }
+
+    double error = std::max(luError, checkLINPACKresults(x, matrixSize,
+                                        matrixSize, checkedRows));
+
+    std::shared_ptr<RefinementResults> refinement;
+    if (config->refinementIterations > 0) {
+        refinement = refineSolution(a, ipvt, lda, matrixSize,
+                                    config->refinementIterations);
+    }
+
+    free(reinterpret_cast<void *>(a));
+#if TILE_LAYOUT
+    free(reinterpret_cast<void *>(a_device));
+#endif
+    free(reinterpret_cast<void *>(b));
+    free(reinterpret_cast<void *>(ipvt));
+    free(reinterpret_cast<void *>(x));
+
+    std::shared_ptr<ExecutionResults> results(
+                    new ExecutionResults{executionTimes,
+                                         error, refinement, phaseTimes, 1,
+                                         std::vector<cl_ulong>()});
+    return results;
+}
+
+/*
+ Factorize the matrix with the connected kernels and solve all right-hand
+ sides with gesl
+
+ @copydoc bm_execution::solve()
+*/
+PhaseTimes
+solve(std::shared_ptr<ExecutionConfiguration> config, const DATA_TYPE* a,
+      DATA_TYPE* b, uint nrhs) {
+    ulong matrixSize = config->matrixSize;
+    uint lda = matrixSize;
+    uint aSize = matrixSize / config->blockSize;
+    int err;
+
+    std::shared_ptr<ExecutionResources> resources =
+                                                prepareResources(config, 1);
+    cl::CommandQueue compute_queue = resources->queues[0];
+    cl::CommandQueue panel_queue = resources->queues[1];
+    cl::CommandQueue update_queue = resources->queues[2];
+    cl::CommandQueue store_panel_queue = resources->queues[3];
+    cl::CommandQueue store_update_queue = resources->queues[4];
+    cl::Buffer Buffer_a = resources->buffers[0];
+    cl::Buffer Buffer_b = resources->buffers[1];
+    cl::Buffer Buffer_pivot = resources->buffers[2];
+    cl::Kernel readkernel = resources->kernels[0];
+    cl::Kernel panelkernel = resources->kernels[1];
+    cl::Kernel updatekernel = resources->kernels[2];
+    cl::Kernel storepanelkernel = resources->kernels[3];
+    cl::Kernel storeupdatekernel = resources->kernels[4];
+    cl::Kernel geslkernel = resources->kernels[5];
+
+    err = readkernel.setArg(0, Buffer_a);
+    THROW_CL(err);
+    err = readkernel.setArg(1, aSize);
+    THROW_CL(err);
+    err = panelkernel.setArg(0, Buffer_pivot);
+    THROW_CL(err);
+    err = panelkernel.setArg(1, aSize);
+    THROW_CL(err);
+    err = updatekernel.setArg(0, aSize);
+    THROW_CL(err);
+    err = updatekernel.setArg(1, config->replications);
+    THROW_CL(err);
+    err = storepanelkernel.setArg(0, Buffer_a);
+    THROW_CL(err);
+    err = storepanelkernel.setArg(1, aSize);
+    THROW_CL(err);
+    err = storeupdatekernel.setArg(0, Buffer_a);
+    THROW_CL(err);
+    err = storeupdatekernel.setArg(1, aSize);
+    THROW_CL(err);
+    err = storeupdatekernel.setArg(2, config->replications);
+    THROW_CL(err);
+    err = geslkernel.setArg(0, Buffer_a);
+    THROW_CL(err);
+    err = geslkernel.setArg(1, Buffer_b);
+    THROW_CL(err);
+    err = geslkernel.setArg(2, Buffer_pivot);
+    THROW_CL(err);
+    err = geslkernel.setArg(3, aSize);
+    THROW_CL(err);
+
+    // Matrix in the layout that is used by the kernels
+    const DATA_TYPE* a_device = a;
+#if TILE_LAYOUT
+    DATA_TYPE* a_tiles;
+    posix_memalign(reinterpret_cast<void**>(&a_tiles), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    convertToTileLayout(a, a_tiles, matrixSize, lda, config->blockSize);
+    a_device = a_tiles;
+#endif
+
+    // The matrix is factorized once and the right-hand sides are solved
+    // one after the other with the same factorization
+    std::vector<cl::Event> writeEvents(nrhs + 1);
+    std::vector<cl::Event> gefaEvents(5);
+    std::vector<cl::Event> geslEvents(nrhs);
+    std::vector<cl::Event> readEvents(nrhs);
+    // If a command fails, all queues are finished before the host buffers
+    // are freed, because the enqueued transfers may still access them
+    std::vector<cl::CommandQueue> queues{store_update_queue,
+                                         store_panel_queue, update_queue,
+                                         panel_queue, compute_queue};
+    try {
+        err = compute_queue.enqueueWriteBuffer(Buffer_a, CL_TRUE, 0,
+                                sizeof(DATA_TYPE)*lda*matrixSize, a_device,
+                                nullptr, &writeEvents[0]);
+        THROW_CL(err);
+        err = store_update_queue.enqueueTask(storeupdatekernel, nullptr,
+                                             &gefaEvents[0]);
+        THROW_CL(err);
+        err = store_panel_queue.enqueueTask(storepanelkernel, nullptr,
+                                            &gefaEvents[1]);
+        THROW_CL(err);
+        err = update_queue.enqueueTask(updatekernel, nullptr,
+                                       &gefaEvents[2]);
+        THROW_CL(err);
+        err = panel_queue.enqueueTask(panelkernel, nullptr, &gefaEvents[3]);
+        THROW_CL(err);
+        err = compute_queue.enqueueTask(readkernel, nullptr,
+                                        &gefaEvents[4]);
+        THROW_CL(err);
+        for (cl::CommandQueue& queue : queues) {
+            err = queue.finish();
+            THROW_CL(err);
+        }
+        for (int i = 0; i < nrhs; i++) {
+            err = compute_queue.enqueueWriteBuffer(Buffer_b, CL_FALSE, 0,
+                                    sizeof(DATA_TYPE)*matrixSize,
+                                    b + i * matrixSize, nullptr,
+                                    &writeEvents[i + 1]);
+            THROW_CL(err);
+            err = compute_queue.enqueueTask(geslkernel, nullptr,
+                                            &geslEvents[i]);
+            THROW_CL(err);
+            err = compute_queue.enqueueReadBuffer(Buffer_b, CL_FALSE, 0,
+                                    sizeof(DATA_TYPE)*matrixSize,
+                                    b + i * matrixSize, nullptr,
+                                    &readEvents[i]);
+            THROW_CL(err);
+        }
+        err = compute_queue.finish();
+        THROW_CL(err);
+    } catch (...) {
+        for (cl::CommandQueue& queue : queues) {
+            queue.finish();
+        }
+#if TILE_LAYOUT
+        free(reinterpret_cast<void *>(a_tiles));
+#endif
+        throw;
+    }
+
+#if TILE_LAYOUT
+    free(reinterpret_cast<void *>(a_tiles));
+#endif
+
+    return PhaseTimes{fpga_setup::getEventTimeSum(writeEvents),
+                      fpga_setup::getEventTime(gefaEvents),
+                      fpga_setup::getEventTimeSum(geslEvents),
+                      fpga_setup::getEventTimeSum(readEvents)};
+}
+
+
+/*
+ Keep multiple factorizations and solves in flight with one queue and one
+ set of buffers per slot. The kernels of the factorization are connected by
+ channels, so the factorizations of the jobs are executed one after the
+ other and only the transfers and gesl overlap with them.
+
+ @copydoc bm_execution::throughput()
+*/
+std::shared_ptr<ThroughputResults>
+throughput(std::shared_ptr<ExecutionConfiguration> config, uint jobs,
+           uint inFlight) {
+    ulong matrixSize = config->matrixSize;
+    uint lda = matrixSize;
+    uint aSize = matrixSize / config->blockSize;
+    int err;
+
+    // All jobs solve the same generated matrix, so it is only generated once
+    DATA_TYPE* a;
+    posix_memalign(reinterpret_cast<void**>(&a), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    DATA_TYPE* b;
+    posix_memalign(reinterpret_cast<void**>(&b), 64,
+                  sizeof(DATA_TYPE)* matrixSize);
+    // Solutions of the last job of every slot
+    DATA_TYPE* x;
+    posix_memalign(reinterpret_cast<void**>(&x), 64,
+                  sizeof(DATA_TYPE)* matrixSize * inFlight);
+    DATA_TYPE norma = 0;
+    matgen(a, lda, matrixSize, b, &norma);
+    DATA_TYPE* a_device = a;
+#if TILE_LAYOUT
+    posix_memalign(reinterpret_cast<void**>(&a_device), 64,
+                  sizeof(DATA_TYPE)*lda*matrixSize);
+    convertToTileLayout(a, a_device, matrixSize, lda, config->blockSize);
+#endif
+
+    // The kernel arguments are copied when a kernel is enqueued, so the
+    // kernels can be shared between the slots
+    std::vector<std::string> kernelNames = {GEFA_KERNEL "_read",
+                    GEFA_KERNEL "_panel", GEFA_KERNEL "_update",
+                    GEFA_KERNEL "_store_panel", GEFA_KERNEL "_store_update",
+                    GESL_KERNEL};
+    std::vector<cl::Kernel> kernels;
+    for (const std::string& name : kernelNames) {
+        kernels.push_back(cl::Kernel(config->program, name.c_str(), &err));
+        ASSERT_CL(err);
+    }
+    cl::Kernel readkernel = kernels[0];
+    cl::Kernel panelkernel = kernels[1];
+    cl::Kernel updatekernel = kernels[2];
+    cl::Kernel storepanelkernel = kernels[3];
+    cl::Kernel storeupdatekernel = kernels[4];
+    cl::Kernel geslkernel = kernels[5];
+
+    // The panel, update and store kernels are shared by all slots and get
+    // one queue each. Every slot has its own queue for the transfers, the
+    // read kernel and gesl.
+    std::vector<cl::CommandQueue> stageQueues;
+    for (int i = 0; i < 4; i++) {
+        stageQueues.push_back(cl::CommandQueue(config->context,
+                                config->device, CL_QUEUE_PROFILING_ENABLE));
+    }
+    std::vector<cl::CommandQueue> queues;
+    std::vector<cl::Buffer> Buffer_a;
+    std::vector<cl::Buffer> Buffer_b;
+    std::vector<cl::Buffer> Buffer_pivot;
+    for (uint slot = 0; slot < inFlight; slot++) {
+        queues.push_back(cl::CommandQueue(config->context, config->device,
+                                          CL_QUEUE_PROFILING_ENABLE));
+        Buffer_a.push_back(cl::Buffer(config->context, CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*lda*matrixSize));
+        Buffer_b.push_back(cl::Buffer(config->context, CL_MEM_READ_WRITE,
+                                sizeof(DATA_TYPE)*matrixSize));
+        Buffer_pivot.push_back(cl::Buffer(config->context, CL_MEM_READ_WRITE,
+                                sizeof(cl_int)*matrixSize));
+    }
+
+    err = readkernel.setArg(1, aSize);
+    ASSERT_CL(err);
+    err = panelkernel.setArg(1, aSize);
+    ASSERT_CL(err);
+    err = updatekernel.setArg(0, aSize);
+    ASSERT_CL(err);
+    err = updatekernel.setArg(1, config->replications);
+    ASSERT_CL(err);
+    err = storepanelkernel.setArg(1, aSize);
+    ASSERT_CL(err);
+    err = storeupdatekernel.setArg(1, aSize);
+    ASSERT_CL(err);
+    err = storeupdatekernel.setArg(2, config->replications);
+    ASSERT_CL(err);
+    err = geslkernel.setArg(3, aSize);
+    ASSERT_CL(err);
+
+    // Events of the factorization of the previous job. The channels are
+    // shared by all jobs, so a factorization is only started after the
+    // previous one is completed.
+    std::vector<cl::Event> previousGefa;
+    auto enqueueJob = [&](uint slot) {
+        std::vector<cl::Event> writeEvents(2);
+        std::vector<cl::Event> gefaEvents(5);
+        std::vector<cl::Event> events(2);
+        queues[slot].enqueueWriteBuffer(Buffer_a[slot], CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*lda*matrixSize, a_device,
+                                nullptr, &writeEvents[0]);
+        queues[slot].enqueueWriteBuffer(Buffer_b[slot], CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*matrixSize, b,
+                                nullptr, &writeEvents[1]);
+        err = panelkernel.setArg(0, Buffer_pivot[slot]);
+        ASSERT_CL(err);
+        err = storepanelkernel.setArg(0, Buffer_a[slot]);
+        ASSERT_CL(err);
+        err = storeupdatekernel.setArg(0, Buffer_a[slot]);
+        ASSERT_CL(err);
+        err = readkernel.setArg(0, Buffer_a[slot]);
+        ASSERT_CL(err);
+        stageQueues[3].enqueueTask(storeupdatekernel, &previousGefa,
+                                   &gefaEvents[0]);
+        stageQueues[2].enqueueTask(storepanelkernel, &previousGefa,
+                                   &gefaEvents[1]);
+        stageQueues[1].enqueueTask(updatekernel, &previousGefa,
+                                   &gefaEvents[2]);
+        stageQueues[0].enqueueTask(panelkernel, &previousGefa,
+                                   &gefaEvents[3]);
+        queues[slot].enqueueTask(readkernel, &previousGefa, &gefaEvents[4]);
+        err = geslkernel.setArg(0, Buffer_a[slot]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(1, Buffer_b[slot]);
+        ASSERT_CL(err);
+        err = geslkernel.setArg(2, Buffer_pivot[slot]);
+        ASSERT_CL(err);
+        queues[slot].enqueueTask(geslkernel, &gefaEvents, &events[0]);
+        queues[slot].enqueueReadBuffer(Buffer_b[slot], CL_FALSE, 0,
+                                sizeof(DATA_TYPE)*matrixSize,
+                                x + slot * matrixSize, nullptr, &events[1]);
+        for (cl::CommandQueue& queue : stageQueues) {
+            queue.flush();
+        }
+        queues[slot].flush();
+        previousGefa = gefaEvents;
+        events.insert(events.end(), writeEvents.begin(), writeEvents.end());
+        events.insert(events.end(), gefaEvents.begin(), gefaEvents.end());
+        return events;
+    };
+
+    std::shared_ptr<ThroughputResults> results =
+                            scheduleJobs(jobs, inFlight, enqueueJob, nullptr);
+
+    results->errorRate = checkLINPACKresults(
+                            x + ((jobs - 1) % inFlight) * matrixSize,
+                            matrixSize, matrixSize, 0);
+
+    free(reinterpret_cast<void *>(a));
+#if TILE_LAYOUT
+    free(reinterpret_cast<void *>(a_device));
+#endif
+    free(reinterpret_cast<void *>(b));
+    free(reinterpret_cast<void *>(x));
+    return results;
+}
+
+}  // namespace bm_execution
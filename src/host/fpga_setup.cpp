@@ -26,11 +26,24 @@ SOFTWARE.
 /* C++ standard library */
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <string>
 #include <iostream>
 #include <vector>
 #include <iomanip>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+/* System headers */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 /* External libraries */
 #include "CL/cl.hpp"
@@ -42,42 +55,117 @@ FPGAs.
 */
 namespace fpga_setup {
 
+/**
+Context and program that were created for the devices and the binary of a
+kernel file
+*/
+struct CachedProgram {
+    cl::Context context;
+    cl::Program program;
+};
+
 /*
  @copydoc fpga_setup::fpgaSetup()
 */
 cl::Program
-fpgaSetup(cl::Context context, std::vector<cl::Device> deviceList,
-          std::string usedKernelFile) {
+fpgaSetup(std::vector<cl::Device> deviceList, std::string usedKernelFile,
+          cl::Context* context, ProgramLoadInfo* loadInfo) {
+    // Programs that were already created for the devices and a binary. The
+    // contexts are kept with them, so the FPGA stays configured with the
+    // program until the process ends.
+    static std::map<std::pair<std::vector<cl_device_id>, uint64_t>,
+                    CachedProgram> programs;
+    static std::mutex programsMutex;
     int err;
 
     std::cout << HLINE;
     std::cout << "FPGA Setup:" << usedKernelFile << std::endl;
 
-    // Open file stream if possible
-    std::ifstream aocxStream(usedKernelFile, std::ifstream::binary);
-    if (!aocxStream.is_open()) {
-        std::cerr << "Not possible to open from given file!" << std::endl;
+    auto startLoad = std::chrono::high_resolution_clock::now();
+
+    // Map the file into memory, so it does not have to be copied. The
+    // mapping is populated, so the file is completely read here and not
+    // while the program is created.
+    int fd = open(usedKernelFile.c_str(), O_RDONLY);
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw std::runtime_error("Not possible to open the kernel file "
+                                 + usedKernelFile);
+    }
+    size_t fileSize = fileStat.st_size;
+    void* binary = mmap(nullptr, fileSize, PROT_READ,
+                        MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (binary == MAP_FAILED) {
+        throw std::runtime_error("Not possible to map the kernel file "
+                                 + usedKernelFile);
+    }
+
+    // FNV-1a like hash over 64 bit words of the binary to detect an already
+    // created program. The upper half is folded back after every word, so
+    // every bit of the binary affects the whole hash.
+    uint64_t hash = 14695981039346656037ULL ^ fileSize;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(binary);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= fileSize; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(uint64_t));
+        hash = (hash ^ word) * 1099511628211ULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < fileSize; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+
+    auto startProgram = std::chrono::high_resolution_clock::now();
+
+    std::vector<cl_device_id> devices;
+    for (const cl::Device& device : deviceList) {
+        devices.push_back(device());
+    }
+    auto key = std::make_pair(devices, hash);
+    std::lock_guard<std::mutex> lock(programsMutex);
+    bool reused = programs.count(key) > 0;
+    if (!reused) {
+        cl::Context newContext(deviceList);
+        cl::Program::Binaries mybinaries;
+        mybinaries.push_back({binary, fileSize});
+
+        // Create the Program from the AOCX file.
+        cl::Program program(newContext, deviceList, mybinaries, NULL, &err);
+        if (err != CL_SUCCESS) {
+            munmap(binary, fileSize);
+            THROW_CL(err);
+        }
+        programs[key] = CachedProgram{newContext, program};
+    }
+    munmap(binary, fileSize);
+    *context = programs[key].context;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> loadTime =
+        std::chrono::duration_cast<std::chrono::duration<double>>
+                                                    (startProgram - startLoad);
+    std::chrono::duration<double> programTime =
+        std::chrono::duration_cast<std::chrono::duration<double>>
+                                                    (end - startProgram);
+    if (loadInfo) {
+        *loadInfo = ProgramLoadInfo{loadTime.count(), programTime.count(),
+                                    reused};
     }
 
-    // Read in file contents and create program from binaries
-    std::string prog(std::istreambuf_iterator<char>(aocxStream),
-                    (std::istreambuf_iterator<char>()));
-    aocxStream.seekg(0, aocxStream.end);
-    unsigned file_size = aocxStream.tellg();
-    aocxStream.seekg(0, aocxStream.beg);
-    char * buf = new char[file_size];
-    aocxStream.read(buf, file_size);
-
-    cl::Program::Binaries mybinaries;
-    mybinaries.push_back({buf, file_size});
-
-    // Create the Program from the AOCX file.
-    cl::Program program(context, deviceList, mybinaries, NULL, &err);
-    ASSERT_CL(err);
-    std::cout << "Prepared FPGA successfully for global Execution!" <<
-                 std::endl;
+    if (reused) {
+        std::cout << "Reused the program of the identical binary!"
+                  << std::endl;
+    } else {
+        std::cout << "Prepared FPGA successfully for global Execution!" <<
+                     std::endl;
+    }
     std::cout << HLINE;
-    return program;
+    return programs[key].program;
 }
 
 /*
@@ -111,7 +199,7 @@ selectFPGADevice(int defaultPlatform, int defaultDevice) {
 
     std::vector<cl::Platform> platformList;
     err = cl::Platform::get(&platformList);
-    ASSERT_CL(err);
+    THROW_CL(err);
 
     // Choose the target platform
     int chosenPlatformId = 0;
@@ -119,10 +207,10 @@ selectFPGADevice(int defaultPlatform, int defaultDevice) {
         if (defaultPlatform < platformList.size()) {
             chosenPlatformId = defaultPlatform;
         } else {
-            std::cerr << "Default platform " << defaultPlatform
-            << " can not be used. Available platforms: "
-            << platformList.size() << std::endl;
-            exit(1);
+            throw std::runtime_error("Default platform "
+                        + std::to_string(defaultPlatform)
+                        + " can not be used. Available platforms: "
+                        + std::to_string(platformList.size()));
         }
     } else if (platformList.size() > 1) {
         std::cout <<
@@ -137,6 +225,10 @@ selectFPGADevice(int defaultPlatform, int defaultDevice) {
         std::cout << "Enter platform id [0-" << platformList.size() - 1
                   << "]:";
         std::cin >> chosenPlatformId;
+        if (!std::cin || chosenPlatformId < 0
+                || chosenPlatformId >= platformList.size()) {
+            throw std::runtime_error("Invalid platform selected");
+        }
     }
     cl::Platform platform = platformList[chosenPlatformId];
     std::cout << "Selected Platform: "
@@ -144,7 +236,7 @@ selectFPGADevice(int defaultPlatform, int defaultDevice) {
 
     std::vector<cl::Device> deviceList;
     err = platform.getDevices(CL_DEVICE_TYPE_ACCELERATOR, &deviceList);
-    ASSERT_CL(err);
+    THROW_CL(err);
 
     // Choose taget device
     int chosenDeviceId = 0;
@@ -152,10 +244,10 @@ selectFPGADevice(int defaultPlatform, int defaultDevice) {
         if (defaultDevice < deviceList.size()) {
             chosenDeviceId = defaultDevice;
         } else {
-            std::cerr << "Default platform " << defaultDevice
-            << " can not be used. Available platforms: "
-            << deviceList.size()  << std::endl;
-            exit(1);
+            throw std::runtime_error("Default device "
+                        + std::to_string(defaultDevice)
+                        + " can not be used. Available devices: "
+                        + std::to_string(deviceList.size()));
         }
     } else if (deviceList.size() > 1) {
         std::cout <<
@@ -169,6 +261,10 @@ selectFPGADevice(int defaultPlatform, int defaultDevice) {
         }
         std::cout << "Enter device id [0-" << deviceList.size() - 1 << "]:";
         std::cin >> chosenDeviceId;
+        if (!std::cin || chosenDeviceId < 0
+                || chosenDeviceId >= deviceList.size()) {
+            throw std::runtime_error("Invalid device selected");
+        }
     }
     std::vector<cl::Device> chosenDeviceList;
     chosenDeviceList.push_back(deviceList[chosenDeviceId]);
@@ -200,6 +296,48 @@ handleClReturnCode(cl_int const err, std::string const file,
     }
 }
 
+/*
+ @copydoc fpga_setup::throwClReturnCode()
+*/
+void
+throwClReturnCode(cl_int const err, std::string const file,
+                  int const line) {
+    if (err != CL_SUCCESS) {
+        throw std::runtime_error("ERROR in OpenCL library detected! "
+                                 + file + ":" + std::to_string(line) + ": "
+                                 + getCLErrorString(err));
+    }
+}
+
+/*
+ @copydoc fpga_setup::getEventTime()
+*/
+double
+getEventTime(const std::vector<cl::Event>& events) {
+    cl_ulong start = std::numeric_limits<cl_ulong>::max();
+    cl_ulong end = 0;
+    for (const cl::Event& event : events) {
+        start = std::min(start,
+                    event.getProfilingInfo<CL_PROFILING_COMMAND_START>());
+        end = std::max(end,
+                    event.getProfilingInfo<CL_PROFILING_COMMAND_END>());
+    }
+    return static_cast<double>(end - start) * 1.0e-9;
+}
+
+/*
+ @copydoc fpga_setup::getEventTimeSum()
+*/
+double
+getEventTimeSum(const std::vector<cl::Event>& events) {
+    cl_ulong sum = 0;
+    for (const cl::Event& event : events) {
+        sum += event.getProfilingInfo<CL_PROFILING_COMMAND_END>()
+                - event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+    }
+    return static_cast<double>(sum) * 1.0e-9;
+}
+
 /*
  @copydoc fpga_setup::getCLErrorString()
 */
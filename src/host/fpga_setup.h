@@ -46,19 +46,50 @@ line number.
 */
 #define ASSERT_CL(err) fpga_setup::handleClReturnCode(err, __FILE__, __LINE__)
 
+/**
+Makro that throws an exception for OpenCL errors with the file and line
+number. It is used by the functions that are called by the solver, so the
+application can handle the error instead of being stopped.
+*/
+#define THROW_CL(err) fpga_setup::throwClReturnCode(err, __FILE__, __LINE__)
+
 namespace fpga_setup {
 
+/**
+Times needed to load the kernel file and to create the program from it.
+
+@see fpga_setup::fpgaSetup()
+*/
+struct ProgramLoadInfo {
+    // Time to read the kernel file into memory and to hash it in seconds
+    double loadTime;
+    // Time to create the program and to program the FPGA in seconds
+    double programTime;
+    // True, if an already created program with the same binary was reused
+    bool reused;
+};
+
 /**
 Sets up the given FPGA with the kernel in the provided file.
+The file is mapped into memory instead of being copied. The created contexts
+and programs are kept for the devices by the hash of the binary. If the same
+kernel file is set up again for the same devices in the process, for
+example by a second Solver, the context and the program are reused, so the
+FPGA is not programmed again.
 
-@param context The context used for the program
-@param program The devices used for the program
+@param deviceList The devices used for the program
 @param usedKernelFile The path to the kernel file
+@param context The context of the program is stored here. The kernels,
+               buffers and queues have to be created in this context.
+@param loadInfo If not null, the load and programming times are stored here
 @return The program that is used to create the benchmark kernels
+
+@throws std::runtime_error if the kernel file can not be read or the
+        program can not be created
 */
 cl::Program
-fpgaSetup(cl::Context context, std::vector<cl::Device> deviceList,
-                     std::string usedKernelFile);
+fpgaSetup(std::vector<cl::Device> deviceList, std::string usedKernelFile,
+          cl::Context* context, ProgramLoadInfo* loadInfo = nullptr);
 
 /**
 Sets up the C++ environment by configuring std::cout and checking the clock
@@ -80,11 +111,38 @@ choose a device.
                         interactively
 
 @return A list containing a single selected device
+
+@throws std::runtime_error if the platform or the device does not exist
 */
 std::vector<cl::Device>
 selectFPGADevice(int defaultPlatform, int defaultDevice);
 
 
+/**
+Calculates the time between the start of the first and the end of the last
+command of the given events using their profiling information.
+The command queues have to be created with CL_QUEUE_PROFILING_ENABLE.
+
+@param events The events of the commands. They have to be completed.
+
+@return The elapsed time on the device in seconds
+*/
+double
+getEventTime(const std::vector<cl::Event>& events);
+
+/**
+Calculates the sum of the execution times of the commands of the given
+events using their profiling information.
+In contrast to getEventTime(), the time between the commands is not
+included.
+
+@param events The events of the commands. They have to be completed.
+
+@return The summed execution time on the device in seconds
+*/
+double
+getEventTimeSum(const std::vector<cl::Event>& events);
+
 /**
 Converts the reveived OpenCL error to a string
 
@@ -106,5 +164,17 @@ void
 handleClReturnCode(cl_int const err, std::string const file,
                    int const  line);
 
+/**
+Check the OpenCL return code for errors.
+
+@param err The OpenCL error code
+
+@throws std::runtime_error if an error is detected. The message contains
+        the file, the line and the name of the error.
+*/
+void
+throwClReturnCode(cl_int const err, std::string const file,
+                  int const line);
+
 }  // namespace fpga_setup
 #endif  // SRC_HOST_FPGA_SETUP_H_
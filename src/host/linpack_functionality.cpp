@@ -24,13 +24,19 @@ SOFTWARE.
 #include "src/host/linpack_functionality.h"
 
 /* C++ standard library headers */
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <string>
 #include <limits>
 #include <iomanip>
 #include <memory>
-#include <random>
+#include <numeric>
+#include <sstream>
 #include <vector>
 
 /* External library headers */
@@ -43,6 +49,7 @@ SOFTWARE.
 /* Project's headers */
 #include "src/host/fpga_setup.h"
 #include "src/host/execution.h"
+#include "src/host/performance_model.h"
 
 
 /**
@@ -53,6 +60,20 @@ Supports the following parameters:
     - number of kernel replications (-r)
     - data size (-d)
     - use memory interleaving
+    - verification mode (--verify) and number of checked rows (--verify-rows)
+    - maximum number of iterations to refine the solution (--refine)
+    - overlap the data generation with the kernel execution (--pipelined)
+    - number of warm-up repetitions (-w)
+    - format (--output-format) and path (--output-file) of the result file
+    - matrix sizes of a sweep (--sweep)
+    - socket path of the solver service (--service) and the largest
+      accepted matrix size (--service-max-size) and number of right-hand
+      sides (--service-max-rhs)
+    - number of matrices of the batched kernels (--batch)
+    - number of jobs in flight (--in-flight) and jobs (--jobs) of the
+      throughput mode
+    - map the matrix buffers instead of copying the matrix (--zero-copy)
+    - upload and factorize the matrix in chunks of block rows (--stream)
 @see https://github.com/jarro2783/cxxopts
 
 @return program settings that are created from the given program arguments
@@ -65,6 +86,12 @@ parseProgramParameters(int argc, char * argv[]) {
         ("f,file", "Kernel file name", cxxopts::value<std::string>())
         ("n", "Number of repetitions",
                 cxxopts::value<uint>()->default_value(std::to_string(NTIMES)))
+        ("w,warmup", "Number of repetitions that are executed before the "\
+        "measured repetitions and are excluded from the results.",
+            cxxopts::value<uint>()->default_value(std::to_string(1)))
+        ("r", "Number of used replications of the C4 unit. Must be between 1 "\
+        "and the number of replications in the kernel.",
+            cxxopts::value<uint>()->default_value(std::to_string(REPLICATIONS)))
         ("b", "Used block size",
             cxxopts::value<uint>()->default_value(std::to_string(BLOCK_SIZE)))
         ("m,matrix", "Size of the matrix (NxN)",
@@ -78,6 +105,70 @@ parseProgramParameters(int argc, char * argv[]) {
         "you will be asked which platform to use if there are multiple "\
         "platforms available.",
             cxxopts::value<int>()->default_value(std::to_string(-1)))
+        ("verify", "Verification mode. 'full' checks the residual over all "\
+        "rows. 'fast' checks the LU factorization with random probe vectors "\
+        "and the residual over a subset of the rows.",
+            cxxopts::value<std::string>()->default_value("full"))
+        ("verify-rows", "Number of rows that are used to calculate the "\
+        "residual in the fast verification mode. If 0, all rows are used.",
+            cxxopts::value<ulong>()->default_value(std::to_string(0)))
+        ("refine", "Maximum number of iterations for the mixed-precision "\
+        "iterative refinement of the solution. If 0, the solution is not "\
+        "refined.", cxxopts::value<uint>()->default_value(std::to_string(0)))
+        ("pipelined", "Generate and upload the matrix of the next "\
+        "repetition while the kernel of the current repetition is executed. "\
+        "Uses two buffers for the matrix on the device.")
+        ("output-format", "Format of the result file. 'text' only prints "\
+        "the results to stdout. 'json' or 'csv' additionally write all "\
+        "measurements to the file given with --output-file.",
+            cxxopts::value<std::string>()->default_value("text"))
+        ("output-file", "Path of the result file",
+            cxxopts::value<std::string>()->default_value(""))
+        ("sweep", "Comma separated list of matrix sizes that are calculated "\
+        "one after the other with the same program and buffers instead of "\
+        "-m. An entry can also be a range 'start:end:step'. Every size must "\
+        "be a multiple of the block size.",
+            cxxopts::value<std::string>()->default_value(""))
+        ("service", "Run as a service that keeps the FPGA programmed and "\
+        "solves the jobs that are sent to the UNIX socket with the given "\
+        "path instead of executing the benchmark.",
+            cxxopts::value<std::string>()->default_value(""))
+        ("service-max-size", "Largest matrix size that is accepted by the "\
+        "service. Larger requests are answered with an error.",
+            cxxopts::value<ulong>()->default_value(std::to_string(16384)))
+        ("service-max-rhs", "Largest number of right-hand sides of a "\
+        "request that is accepted by the service.",
+            cxxopts::value<uint>()->default_value(std::to_string(1024)))
+        ("batch", "Number of matrices of size -m that are factorized and "\
+        "solved with a single kernel execution. Only used by the batched "\
+        "kernels.",
+            cxxopts::value<uint>()->default_value(std::to_string(1)))
+        ("in-flight", "Measure the throughput with the given number of "\
+        "independent jobs in flight instead of executing the benchmark. "\
+        "Every job has its own queue and buffers on the device. If 0, the "\
+        "benchmark is executed.",
+            cxxopts::value<uint>()->default_value(std::to_string(0)))
+        ("jobs", "Total number of jobs in the throughput mode",
+            cxxopts::value<uint>()->default_value(std::to_string(100)))
+        ("zero-copy", "Generate the matrix directly in the mapped buffers "\
+        "in host accessible memory and read the factorization in place "\
+        "instead of copying the matrix. Only used by blocked_pvt.")
+        ("stream", "Upload the matrix in chunks of the given number of "\
+        "block rows and factorize every chunk as soon as it is uploaded, "\
+        "while the next chunks are transferred. If 0, the whole matrix is "\
+        "uploaded before the factorization. Only used by blocked_pvt.",
+            cxxopts::value<uint>()->default_value(std::to_string(0)))
+        ("fmax", "Kernel clock in MHz that is used by the performance model",
+            cxxopts::value<double>()->default_value(
+                                            std::to_string(MODEL_FMAX)))
+        ("bandwidth", "Bandwidth of the global memory in GB/s that is used "\
+        "by the performance model",
+            cxxopts::value<double>()->default_value(
+                                            std::to_string(MODEL_BANDWIDTH)))
+        ("c4-throughput", "Floating point operations of C4 per cycle that "\
+        "are used by the performance model. If 0, it is derived from the "\
+        "C4 implementation of the kernel.",
+            cxxopts::value<double>()->default_value(std::to_string(0)))
         ("h,help", "Print this help");
     cxxopts::ParseResult result = options.parse(argc, argv);
 
@@ -93,27 +184,526 @@ parseProgramParameters(int argc, char * argv[]) {
         std::cout << options.help() << std::endl;
         exit(0);
     }
+    // The statistics of the results need at least one measured repetition
+    if (result["n"].as<uint>() < 1) {
+        std::cerr << "Number of repetitions must be at least 1! Aborting"
+                  << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+    if (result["r"].as<uint>() < 1 || result["r"].as<uint>() > REPLICATIONS) {
+        std::cerr << "Number of replications must be between 1 and "
+                  << REPLICATIONS << "! Aborting" << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+    bm_execution::VerificationMode verificationMode;
+    std::string verify = result["verify"].as<std::string>();
+    if (verify == "full") {
+        verificationMode = bm_execution::VerificationMode::full;
+    } else if (verify == "fast") {
+        verificationMode = bm_execution::VerificationMode::fast;
+    } else {
+        std::cerr << "Unknown verification mode: " << verify << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+
+    OutputFormat outputFormat;
+    std::string format = result["output-format"].as<std::string>();
+    if (format == "text") {
+        outputFormat = OutputFormat::text;
+    } else if (format == "json") {
+        outputFormat = OutputFormat::json;
+    } else if (format == "csv") {
+        outputFormat = OutputFormat::csv;
+    } else {
+        std::cerr << "Unknown output format: " << format << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+    if (outputFormat != OutputFormat::text
+                    && result["output-file"].as<std::string>().empty()) {
+        std::cerr << "Output file must be given for the output format "
+                  << format << "! Aborting" << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+
+    if (result["batch"].as<uint>() < 1) {
+        std::cerr << "Batch size must be at least 1! Aborting" << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+
+    if (result["in-flight"].as<uint>() > 0) {
+        if (result["jobs"].as<uint>() < 1) {
+            std::cerr << "Number of jobs must be at least 1! Aborting"
+                      << std::endl;
+            std::cout << options.help() << std::endl;
+            exit(1);
+        }
+        if (outputFormat != OutputFormat::text) {
+            std::cerr << "The throughput mode only supports the output "
+                      << "format text! Aborting" << std::endl;
+            std::cout << options.help() << std::endl;
+            exit(1);
+        }
+    }
+
+    std::vector<size_t> sweepSizes;
+    std::stringstream sweep(result["sweep"].as<std::string>());
+    std::string entry;
+    while (std::getline(sweep, entry, ',')) {
+        size_t start, end, step;
+        char sep1, sep2;
+        std::stringstream range(entry);
+        // Negative numbers would be wrapped around by the unsigned parsing
+        if (entry.find('-') != std::string::npos || !(range >> start)) {
+            std::cerr << "Invalid sweep entry: " << entry << std::endl;
+            exit(1);
+        }
+        end = start;
+        step = 1;
+        if (range >> sep1 && !(sep1 == ':' && range >> end >> sep2 >> step
+                                && sep2 == ':' && step > 0)) {
+            std::cerr << "Invalid sweep entry: " << entry << std::endl;
+            exit(1);
+        }
+        // Only white space may follow the last number of the entry
+        range.clear();
+        range >> std::ws;
+        if (!range.eof()) {
+            std::cerr << "Invalid sweep entry: " << entry << std::endl;
+            exit(1);
+        }
+        if (end < start) {
+            std::cerr << "The end of the sweep entry " << entry
+                      << " is smaller than its start! Aborting" << std::endl;
+            exit(1);
+        }
+        // The loop stops before the next size would exceed the end, so it
+        // does not wrap around for ends close to the maximum of size_t
+        for (size_t size = start; ; size += step) {
+            if (size == 0 || size % result["b"].as<uint>() != 0) {
+                std::cerr << "Matrix size " << size << " of the sweep is no "
+                          << "multiple of the block size! Aborting"
+                          << std::endl;
+                exit(1);
+            }
+            sweepSizes.push_back(size);
+            if (end - size < step) {
+                break;
+            }
+        }
+    }
+
+    if (result.count("zero-copy") && MEMORY_BANKS > 1) {
+        std::cerr << "The zero-copy mode only supports a single memory "
+                  << "bank! Aborting" << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+
+    if (result["stream"].as<uint>() > 0
+            && (result.count("pipelined") || result.count("zero-copy"))) {
+        std::cerr << "Streaming can not be combined with the pipelined or "
+                  << "the zero-copy mode! Aborting" << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+
+    if (result["fmax"].as<double>() <= 0
+            || result["bandwidth"].as<double>() <= 0) {
+        std::cerr << "Clock and bandwidth of the performance model must be "
+                  << "positive! Aborting" << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+
+    if (result["m"].as<size_t>() % result["b"].as<uint>() != 0) {
+        std::cerr << "Matrix size is no multiple of the block size! Aborting"
+                  << std::endl;
+        exit(1);
+    }
 
     // Create program settings from program arguments
     std::shared_ptr<ProgramSettings> sharedSettings(
-            new ProgramSettings {result["n"].as<uint>(), result["b"].as<uint>(),
+            new ProgramSettings {result["n"].as<uint>(), result["r"].as<uint>(),
+                                result["b"].as<uint>(),
                                 result["m"].as<size_t>(),
                                 static_cast<bool>(result.count("i") <= 0),
                                 result["device"].as<int>(),
                                 result["platform"].as<int>(),
-                                result["f"].as<std::string>()});
+                                result["f"].as<std::string>(),
+                                verificationMode,
+                                result["verify-rows"].as<ulong>(),
+                                result["refine"].as<uint>(),
+                                static_cast<bool>(result.count("pipelined")),
+                                result["w"].as<uint>(),
+                                outputFormat,
+                                result["output-file"].as<std::string>(),
+                                sweepSizes,
+                                result["service"].as<std::string>(),
+                                result["service-max-size"].as<ulong>(),
+                                result["service-max-rhs"].as<uint>(),
+                                result["batch"].as<uint>(),
+                                result["in-flight"].as<uint>(),
+                                result["jobs"].as<uint>(),
+                                static_cast<bool>(result.count("zero-copy")),
+                                result["stream"].as<uint>(),
+                                result["fmax"].as<double>(),
+                                result["bandwidth"].as<double>(),
+                                result["c4-throughput"].as<double>()});
     return sharedSettings;
 }
 
+/**
+Statistics over the measured times of all repetitions
+*/
+struct TimeStatistics {
+    double min;
+    double max;
+    double mean;
+    double median;
+    double stddev;
+};
+
+/**
+Calculate the statistics for the given times
+
+@param times the measured times. Must not be empty.
+
+@return the statistics of the times
+*/
+static TimeStatistics
+calculateStatistics(std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    size_t n = times.size();
+    double mean = std::accumulate(times.begin(), times.end(), 0.0) / n;
+    double median = (n % 2 == 1) ? times[n / 2]
+                                 : (times[n / 2 - 1] + times[n / 2]) / 2.0;
+    double variance = 0.0;
+    for (double t : times) {
+        variance += (t - mean) * (t - mean);
+    }
+    variance = (n > 1) ? variance / (n - 1) : 0.0;
+    return TimeStatistics{times.front(), times.back(), mean, median,
+                          std::sqrt(variance)};
+}
+
+/**
+Escape a string so it can be used as a JSON string or CSV field
+
+@param value the string that has to be escaped
+@param json if true, the string is escaped for JSON. Otherwise for CSV.
+
+@return the escaped string including the quotes
+*/
+static std::string
+quoteString(const std::string& value, bool json) {
+    std::string quoted = "\"";
+    for (char c : value) {
+        if (c == '"') {
+            quoted += json ? "\\\"" : "\"\"";
+        } else if (c == '\\' && json) {
+            quoted += "\\\\";
+        } else if (static_cast<unsigned char>(c) < 0x20 && json) {
+            // Control characters are not allowed in JSON strings
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+/**
+Number that is written to a JSON file. JSON can not represent infinite
+values and NaN, so they are written as null.
+*/
+struct JSONNumber {
+    double value;
+};
+
+/**
+Write a number to a JSON file
+
+@param out the stream the number is written to
+@param number the number that is written
+
+@return the given stream
+*/
+static std::ostream&
+operator<<(std::ostream& out, JSONNumber number) {
+    if (std::isfinite(number.value)) {
+        return out << number.value;
+    }
+    return out << "null";
+}
+
+double
+gflopCount(size_t matrixSize, uint matrices, bool solve) {
+    double n = static_cast<double>(matrixSize);
+    double flop = 2.0 * n * n * n / 3.0;
+    if (solve) {
+        flop += 2.0 * n * n;
+    }
+    return matrices * flop / 1.0e9;
+}
+
+/**
+Check if the execution times that are measured by the host contain the
+solution with GESL. The blocked kernel only factorizes the matrix on the
+device and the solution is calculated on the host outside of the measured
+time.
+
+@return true, if the execution times contain GEFA and GESL
+*/
+static bool
+timesIncludeSolve() {
+    return std::string(KERNEL_TYPE) != "blocked";
+}
+
+/**
+Write the results of a single matrix size as members of a JSON object.
+The last member is not terminated by a comma or a new line.
+
+@param out the stream the results are written to
+@param matrixSize size of the calculated matrix
+@param results the struct containing the results of the benchmark execution
+@param indent indentation of the members
+*/
+static void
+writeJSONResults(std::ostream& out, size_t matrixSize,
+                 std::shared_ptr<bm_execution::ExecutionResults> results,
+                 const std::string& indent) {
+    double gflop = gflopCount(matrixSize, results->matrices,
+                              timesIncludeSolve());
+    TimeStatistics stats = calculateStatistics(results->times);
+    out << indent << "\"matrices\": " << results->matrices << ","
+        << std::endl
+        << indent << "\"repetitions\": [" << std::endl;
+    for (int i = 0; i < results->times.size(); i++) {
+        out << indent << "  {\"time\": " << JSONNumber{results->times[i]}
+            << ", \"gflops\": " << JSONNumber{gflop / results->times[i]};
+        if (i < results->phases.size()) {
+            const bm_execution::PhaseTimes& phase = results->phases[i];
+            out << ", \"write\": " << JSONNumber{phase.write}
+                << ", \"gefa\": " << JSONNumber{phase.gefa}
+                << ", \"gesl\": " << JSONNumber{phase.gesl}
+                << ", \"read\": " << JSONNumber{phase.read};
+        }
+        out << "}" << ((i + 1 < results->times.size()) ? "," : "")
+            << std::endl;
+    }
+    out << indent << "]," << std::endl
+        << indent << "\"statistics\": {" << std::endl
+        << indent << "  \"min\": " << JSONNumber{stats.min} << ","
+        << std::endl
+        << indent << "  \"max\": " << JSONNumber{stats.max} << ","
+        << std::endl
+        << indent << "  \"mean\": " << JSONNumber{stats.mean} << ","
+        << std::endl
+        << indent << "  \"median\": " << JSONNumber{stats.median} << ","
+        << std::endl
+        << indent << "  \"stddev\": " << JSONNumber{stats.stddev} << ","
+        << std::endl
+        << indent << "  \"gflops\": " << JSONNumber{gflop / stats.min} << ","
+        << std::endl
+        << indent << "  \"matrices_per_second\": "
+        << JSONNumber{results->matrices / stats.min} << std::endl
+        << indent << "}," << std::endl
+        << indent << "\"error\": " << JSONNumber{results->errorRate};
+    if (results->refinement) {
+        out << "," << std::endl
+            << indent << "\"refinement\": {" << std::endl
+            << indent << "  \"time\": "
+            << JSONNumber{results->refinement->time} << "," << std::endl
+            << indent << "  \"solve_time\": "
+            << JSONNumber{results->refinement->solveTime} << ","
+            << std::endl
+            << indent << "  \"iterations\": "
+            << results->refinement->iterations << "," << std::endl
+            << indent << "  \"error\": "
+            << JSONNumber{results->refinement->errorRate}
+            << std::endl
+            << indent << "}";
+    }
+}
+
+/**
+Write the results of a single matrix size as CSV rows.
+Every repetition and every statistic over the repetitions is written to a
+separate row that ends with the given configuration.
+
+@param out the stream the results are written to
+@param matrixSize size of the calculated matrix
+@param results the struct containing the results of the benchmark execution
+@param config the configuration columns that are appended to every row
+*/
+static void
+writeCSVResults(std::ostream& out, size_t matrixSize,
+                std::shared_ptr<bm_execution::ExecutionResults> results,
+                const std::string& config) {
+    double gflop = gflopCount(matrixSize, results->matrices,
+                              timesIncludeSolve());
+    TimeStatistics stats = calculateStatistics(results->times);
+    for (int i = 0; i < results->times.size(); i++) {
+        out << i << "," << results->times[i] << ","
+            << gflop / results->times[i] << ",";
+        if (i < results->phases.size()) {
+            const bm_execution::PhaseTimes& phase = results->phases[i];
+            out << phase.write << "," << phase.gefa << ","
+                << phase.gesl << "," << phase.read << ",";
+        } else {
+            out << ",,,,";
+        }
+        out << config << std::endl;
+    }
+    std::vector<std::pair<std::string, double>> statRows = {
+        {"min", stats.min}, {"max", stats.max}, {"mean", stats.mean},
+        {"median", stats.median}, {"stddev", stats.stddev}};
+    for (auto& row : statRows) {
+        out << row.first << "," << row.second << ",";
+        if (row.first != "stddev") {
+            out << gflop / row.second;
+        }
+        out << ",,,,," << config << std::endl;
+    }
+}
+
+void writeResults(std::shared_ptr<ProgramSettings> settings,
+                  std::string deviceName,
+                  std::vector<std::shared_ptr<bm_execution::ExecutionResults>>
+                                                                    results) {
+    bool sweep = !settings->sweepSizes.empty();
+    std::vector<size_t> matrixSizes = sweep ? settings->sweepSizes
+                            : std::vector<size_t>{settings->matrixSize};
+    std::string verification = (settings->verificationMode
+                        == bm_execution::VerificationMode::fast) ? "fast"
+                                                                 : "full";
+    bool json = settings->outputFormat == OutputFormat::json;
+
+    std::ofstream out(settings->outputFile);
+    if (!out) {
+        std::cerr << "Could not open output file " << settings->outputFile
+                  << std::endl;
+        return;
+    }
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+
+    if (json) {
+        out << "{" << std::endl
+            << "  \"settings\": {" << std::endl
+            << "    \"repetitions\": " << settings->numRepetitions << ","
+            << std::endl
+            << "    \"warmup_repetitions\": " << settings->warmupIterations
+            << "," << std::endl
+            << "    \"replications\": " << settings->numReplications << ","
+            << std::endl
+            << "    \"block_size\": " << settings->blockSize << ","
+            << std::endl;
+        if (!sweep) {
+            out << "    \"matrix_size\": " << settings->matrixSize << ","
+                << std::endl;
+        }
+        out << "    \"memory_interleaving\": "
+            << (settings->useMemInterleaving ? "true" : "false") << ","
+            << std::endl
+            << "    \"device\": " << settings->device << "," << std::endl
+            << "    \"platform\": " << settings->platform << "," << std::endl
+            << "    \"kernel_file\": "
+            << quoteString(settings->kernelFileName, true) << "," << std::endl
+            << "    \"verification\": \"" << verification << "\","
+            << std::endl
+            << "    \"verification_rows\": " << settings->verificationRows
+            << "," << std::endl
+            << "    \"refinement_iterations\": "
+            << settings->refinementIterations << "," << std::endl
+            << "    \"pipelined\": "
+            << (settings->pipelined ? "true" : "false") << "," << std::endl
+            << "    \"batch_size\": " << settings->batchSize << ","
+            << std::endl
+            << "    \"zero_copy\": "
+            << (settings->zeroCopy ? "true" : "false") << "," << std::endl
+            << "    \"stream_blocks\": " << settings->streamBlocks
+            << std::endl
+            << "  }," << std::endl
+            << "  \"build\": {" << std::endl
+            << "    \"block_size\": " << BLOCK_SIZE << "," << std::endl
+            << "    \"global_mem_unroll\": " << GLOBAL_MEM_UNROLL << ","
+            << std::endl
+            << "    \"replications\": " << REPLICATIONS << "," << std::endl
+            << "    \"tile_layout\": " << TILE_LAYOUT << "," << std::endl
+            << "    \"memory_banks\": " << MEMORY_BANKS << std::endl
+            << "  }," << std::endl
+            << "  \"device_name\": " << quoteString(deviceName, true) << ","
+            << std::endl;
+        if (sweep) {
+            // One object with the results of every matrix size
+            out << "  \"sweep\": [" << std::endl;
+            for (int i = 0; i < matrixSizes.size(); i++) {
+                out << "    {" << std::endl
+                    << "      \"matrix_size\": " << matrixSizes[i] << ","
+                    << std::endl;
+                writeJSONResults(out, matrixSizes[i], results[i], "      ");
+                out << std::endl << "    }"
+                    << ((i + 1 < matrixSizes.size()) ? "," : "")
+                    << std::endl;
+            }
+            out << "  ]";
+        } else {
+            writeJSONResults(out, settings->matrixSize, results[0], "  ");
+        }
+        out << std::endl << "}" << std::endl;
+    } else {
+        // Every row contains a single repetition or a statistic over all
+        // repetitions together with the configuration, so the rows can be
+        // collected from multiple runs into a single table
+        out << "repetition,time,gflops,write,gefa,gesl,read,matrix_size,"
+            << "block_size,replications,warmup_repetitions,"
+            << "memory_interleaving,verification,verification_rows,"
+            << "refinement_iterations,pipelined,batch_size,zero_copy,"
+            << "stream_blocks,build_block_size,global_mem_unroll,"
+            << "build_replications,tile_layout,memory_banks,device,"
+            << "kernel_file,error" << std::endl;
+        for (int i = 0; i < matrixSizes.size(); i++) {
+            std::stringstream config;
+            config.precision(out.precision());
+            config << matrixSizes[i] << "," << settings->blockSize << ","
+                   << settings->numReplications << ","
+                   << settings->warmupIterations << ","
+                   << settings->useMemInterleaving << ","
+                   << verification << "," << settings->verificationRows << ","
+                   << settings->refinementIterations << ","
+                   << settings->pipelined << ","
+                   << settings->batchSize << ","
+                   << settings->zeroCopy << ","
+                   << settings->streamBlocks << ","
+                   << BLOCK_SIZE << "," << GLOBAL_MEM_UNROLL << ","
+                   << REPLICATIONS << "," << TILE_LAYOUT << ","
+                   << MEMORY_BANKS << ","
+                   << quoteString(deviceName, false) << ","
+                   << quoteString(settings->kernelFileName, false) << ","
+                   << results[i]->errorRate;
+            writeCSVResults(out, matrixSizes[i], results[i], config.str());
+        }
+    }
+}
+
 /**
 Print the benchmark Results
 
 @param results The result struct provided by the calculation call
 @param dataSize The size of the used data array
+@param settings The settings of the benchmark and the performance model
 
 */
 void printResults(std::shared_ptr<bm_execution::ExecutionResults> results,
-                  size_t dataSize) {
+                  size_t dataSize, std::shared_ptr<ProgramSettings> settings) {
     std::cout << std::setw(ENTRY_SPACE)
               << "best" << std::setw(ENTRY_SPACE) << "mean"
               << std::setw(ENTRY_SPACE) << "GFLOPS"
@@ -123,13 +713,9 @@ void printResults(std::shared_ptr<bm_execution::ExecutionResults> results,
     double tmean = 0;
     double tmin = std::numeric_limits<double>::max();
 
-    // GFLOPs for calculation of both GEFA and GESL.
-    // Currently only GEFA is calculated on the FPGA so GFLOPS have to be
-    // reduced.
-    // double gflops = ((2.0e0*(dataSize*dataSize*dataSize))/3.0
-    //                 + 2.0*(dataSize*dataSize)) / 1.0e9;
-    // TODO: Change this when GESL is also calculated on FPGA
-    double gflops = (2.0e0*(dataSize*dataSize*dataSize))/3.0/1.0e9;
+    // GFLOPs of all matrices for the measured kernels
+    double gflops = gflopCount(dataSize, results->matrices,
+                               timesIncludeSolve());
     for (double currentTime : results->times) {
         tmean +=  currentTime;
         if (currentTime < tmin) {
@@ -143,32 +729,402 @@ void printResults(std::shared_ptr<bm_execution::ExecutionResults> results,
               << std::setw(ENTRY_SPACE) << gflops / tmin
               << std::setw(ENTRY_SPACE) << (results->errorRate)
               << std::endl;
+
+    if (results->matrices > 1) {
+        std::cout << "Matrices per second: " << results->matrices / tmin
+                  << " (" << results->matrices << " matrices)" << std::endl;
+    }
+
+    if (!results->phases.empty()) {
+        // Best and mean time of every phase. The total time includes the
+        // transfers and the solve like the time measured by HPL.
+        std::vector<std::string> names = {"write", "gefa", "gesl", "read",
+                                          "total"};
+        std::vector<std::vector<double>> times(names.size());
+        for (const bm_execution::PhaseTimes& phase : results->phases) {
+            times[0].push_back(phase.write);
+            times[1].push_back(phase.gefa);
+            times[2].push_back(phase.gesl);
+            times[3].push_back(phase.read);
+            times[4].push_back(phase.write + phase.gefa + phase.gesl
+                               + phase.read);
+        }
+        std::cout << std::setw(ENTRY_SPACE)
+                  << "phase" << std::setw(ENTRY_SPACE) << "best"
+                  << std::setw(ENTRY_SPACE) << "mean"
+                  << std::setw(ENTRY_SPACE) << "GFLOPS" << std::endl;
+        for (int i = 0; i < names.size(); i++) {
+            double phaseMin = *std::min_element(times[i].begin(),
+                                                times[i].end());
+            double phaseMean = std::accumulate(times[i].begin(),
+                                        times[i].end(), 0.0) / times[i].size();
+            std::cout << std::setw(ENTRY_SPACE) << names[i]
+                      << std::setw(ENTRY_SPACE) << phaseMin
+                      << std::setw(ENTRY_SPACE) << phaseMean;
+            if (names[i] == "total") {
+                // The total time always contains GEFA and GESL
+                std::cout << std::setw(ENTRY_SPACE)
+                          << gflopCount(dataSize, results->matrices, true)
+                             / phaseMin;
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    bm_model::Schedule schedule;
+    if (!results->phases.empty() && results->matrices == 1
+            && bm_model::parseSchedule(KERNEL_TYPE, &schedule)) {
+        // Compare the best measured time of gefa with the time predicted
+        // by the performance model for the same configuration
+        bm_model::ModelConfiguration model{schedule, dataSize,
+                                settings->blockSize, GLOBAL_MEM_UNROLL,
+                                PANEL_BLOCKS, settings->streamBlocks,
+                                sizeof(DATA_TYPE), settings->fmax,
+                                settings->bandwidth, settings->c4Throughput};
+        std::shared_ptr<bm_model::ModelResults> prediction =
+                                                bm_model::simulate(model);
+        double gefaMin = std::numeric_limits<double>::max();
+        for (const bm_execution::PhaseTimes& phase : results->phases) {
+            gefaMin = std::min(gefaMin, phase.gefa);
+        }
+        double gefaGflop = gflopCount(dataSize, 1, false);
+        std::cout << std::setw(ENTRY_SPACE)
+                  << "model" << std::setw(ENTRY_SPACE) << "predicted"
+                  << std::setw(ENTRY_SPACE) << "measured"
+                  << std::setw(ENTRY_SPACE) << "efficiency" << std::endl;
+        std::cout << std::setw(ENTRY_SPACE)
+                  << "gefa" << std::setw(ENTRY_SPACE) << prediction->time
+                  << std::setw(ENTRY_SPACE) << gefaMin << std::endl;
+        std::cout << std::setw(ENTRY_SPACE)
+                  << "GFLOPS" << std::setw(ENTRY_SPACE) << prediction->gflops
+                  << std::setw(ENTRY_SPACE) << gefaGflop / gefaMin
+                  << std::setw(ENTRY_SPACE)
+                  << prediction->time / gefaMin << std::endl;
+        std::cout << "Model roofs:         " << prediction->computeRoof
+                  << " GFLOPS compute, " << prediction->memoryRoof
+                  << " GFLOPS memory at " << settings->fmax << " MHz, "
+                  << settings->bandwidth << " GB/s" << std::endl;
+    }
+
+    if (!results->stageCounters.empty()) {
+        // Breakdown of the cycles of gefa in the last repetition. The cycles
+        // that are not spent in a stage are loop and memory overheads.
+        const std::vector<cl_ulong>& counters = results->stageCounters;
+        cl_ulong total = counters[bm_execution::totalCycles];
+        cl_ulong stages = counters[bm_execution::c1Cycles]
+                          + counters[bm_execution::c2c3Cycles]
+                          + counters[bm_execution::c4Cycles];
+        std::vector<std::string> names = {"C1", "C2/C3", "C4", "other"};
+        std::vector<cl_ulong> blocks = {counters[bm_execution::c1Blocks],
+                                    counters[bm_execution::c2Blocks]
+                                        + counters[bm_execution::c3Blocks],
+                                    counters[bm_execution::c4Blocks], 0};
+        std::vector<cl_ulong> cycles = {counters[bm_execution::c1Cycles],
+                                    counters[bm_execution::c2c3Cycles],
+                                    counters[bm_execution::c4Cycles],
+                                    total > stages ? total - stages : 0};
+        std::cout << std::setw(ENTRY_SPACE)
+                  << "stage" << std::setw(ENTRY_SPACE) << "blocks"
+                  << std::setw(ENTRY_SPACE) << "cycles"
+                  << std::setw(ENTRY_SPACE) << "cyc/block"
+                  << std::setw(ENTRY_SPACE) << "share" << std::endl;
+        for (int i = 0; i < names.size(); i++) {
+            std::cout << std::setw(ENTRY_SPACE) << names[i]
+                      << std::setw(ENTRY_SPACE) << blocks[i]
+                      << std::setw(ENTRY_SPACE) << cycles[i]
+                      << std::setw(ENTRY_SPACE);
+            if (blocks[i] > 0) {
+                std::cout << static_cast<double>(cycles[i]) / blocks[i];
+            } else {
+                std::cout << "-";
+            }
+            std::cout << std::setw(ENTRY_SPACE)
+                      << static_cast<double>(cycles[i]) / total << std::endl;
+        }
+        // The blocks are transferred from and to global memory as a whole
+        double blockBytes = sizeof(DATA_TYPE) * BLOCK_SIZE * BLOCK_SIZE;
+        cl_ulong transferred = counters[bm_execution::loadedBlocks]
+                               + counters[bm_execution::storedBlocks];
+        std::cout << "Global memory:       "
+                  << counters[bm_execution::loadedBlocks] << " loaded, "
+                  << counters[bm_execution::storedBlocks] << " stored blocks, "
+                  << transferred * blockBytes / total << " bytes/cycle"
+                  << std::endl;
+        // The clock frequency of the kernel is estimated with the measured
+        // time of gefa in the same repetition. With streaming, the gefa time
+        // also contains the waits for the uploads between the chunks, so
+        // the clock is not estimated.
+        if (settings->streamBlocks == 0 && !results->phases.empty()
+                && results->phases.back().gefa > 0) {
+            std::cout << "Kernel clock:        "
+                      << total / results->phases.back().gefa / 1.0e6
+                      << " MHz" << std::endl;
+        }
+    }
+
+    if (results->refinement) {
+        // GFLOPs of the mixed-precision solution as defined in HPL-AI.
+        // The time of the refinement steps is added to the best time. The
+        // first solve on the host is only added if the measured times do
+        // not already contain a solve.
+        double gflops_ai = (2.0e0*(dataSize*dataSize*dataSize)/3.0
+                            + 1.5e0*(dataSize*dataSize)) / 1.0e9;
+        double aiTime = tmin + results->refinement->time;
+        if (!timesIncludeSolve()) {
+            aiTime += results->refinement->solveTime;
+        }
+        std::cout << std::setw(ENTRY_SPACE)
+                  << "refine" << std::setw(ENTRY_SPACE) << "iterations"
+                  << std::setw(ENTRY_SPACE) << "AI GFLOPS"
+                  << std::setw(ENTRY_SPACE) << "error" << std::endl;
+        std::cout << std::setw(ENTRY_SPACE)
+                  << results->refinement->time << std::setw(ENTRY_SPACE)
+                  << results->refinement->iterations
+                  << std::setw(ENTRY_SPACE)
+                  << gflops_ai / aiTime
+                  << std::setw(ENTRY_SPACE)
+                  << results->refinement->errorRate << std::endl;
+    }
 }
 
-void matgen(DATA_TYPE* a, cl_int lda, cl_int n, DATA_TYPE* b,
-            DATA_TYPE* norma) {
-    std::mt19937 gen(7);
-    std::uniform_real_distribution<> dis(-1.0, 1.0);
-    *norma = 0.0;
-    for (int j = 0; j < n; j++) {
-        for (int i = 0; i < n; i++) {
-            a[lda*i+j] = dis(gen);
-            *norma = (a[lda*i+j] > *norma) ? a[lda*i+j] : *norma;
+void
+printThroughputResults(std::shared_ptr<bm_execution::ThroughputResults> results,
+                       size_t matrixSize) {
+    // Every job contains the solution of all matrices, also if it is
+    // calculated on the host
+    double gflop = gflopCount(matrixSize, results->matrices, true);
+    double solves = static_cast<double>(results->jobs) * results->matrices;
+    std::cout << std::setw(ENTRY_SPACE)
+              << "jobs" << std::setw(ENTRY_SPACE) << "in flight"
+              << std::setw(ENTRY_SPACE) << "solves/s"
+              << std::setw(ENTRY_SPACE) << "GFLOPS"
+              << std::setw(ENTRY_SPACE) << "error" << std::endl;
+    std::cout << std::setw(ENTRY_SPACE) << results->jobs
+              << std::setw(ENTRY_SPACE) << results->inFlight
+              << std::setw(ENTRY_SPACE) << solves / results->time
+              << std::setw(ENTRY_SPACE)
+              << gflop * results->jobs / results->time
+              << std::setw(ENTRY_SPACE) << results->errorRate << std::endl;
+
+    // Latency percentiles with the nearest-rank method
+    std::vector<double> latencies(results->latencies);
+    std::sort(latencies.begin(), latencies.end());
+    std::vector<std::pair<std::string, double>> percentiles = {
+        {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"max", 1.0}};
+    std::cout << std::setw(ENTRY_SPACE) << "latency";
+    for (auto& percentile : percentiles) {
+        std::cout << std::setw(ENTRY_SPACE) << percentile.first;
+    }
+    std::cout << std::endl << std::setw(ENTRY_SPACE) << "";
+    for (auto& percentile : percentiles) {
+        size_t rank = static_cast<size_t>(std::ceil(percentile.second
+                                                    * latencies.size()));
+        std::cout << std::setw(ENTRY_SPACE)
+                  << latencies[std::max(rank, static_cast<size_t>(1)) - 1];
+    }
+    std::cout << std::endl;
+}
+
+void printSweepResults(const std::vector<size_t>& matrixSizes,
+                const std::vector<std::shared_ptr<bm_execution::ExecutionResults>>&
+                                                                    results) {
+    std::cout << std::setw(ENTRY_SPACE)
+              << "matrix size" << std::setw(ENTRY_SPACE) << "best"
+              << std::setw(ENTRY_SPACE) << "mean"
+              << std::setw(ENTRY_SPACE) << "GFLOPS"
+              << std::setw(ENTRY_SPACE) << "error" << std::endl;
+    for (int i = 0; i < matrixSizes.size(); i++) {
+        size_t n = matrixSizes[i];
+        double gflops = gflopCount(n, results[i]->matrices,
+                                   timesIncludeSolve());
+        double tmin = *std::min_element(results[i]->times.begin(),
+                                        results[i]->times.end());
+        double tmean = std::accumulate(results[i]->times.begin(),
+                                       results[i]->times.end(), 0.0)
+                       / results[i]->times.size();
+        std::cout << std::setw(ENTRY_SPACE) << n
+                  << std::setw(ENTRY_SPACE) << tmin
+                  << std::setw(ENTRY_SPACE) << tmean
+                  << std::setw(ENTRY_SPACE) << gflops / tmin
+                  << std::setw(ENTRY_SPACE) << results[i]->errorRate
+                  << std::endl;
+    }
+}
+
+DATA_TYPE
+matgen_value(cl_uint seed, ulong row, ulong col) {
+    // Philox2x32-10 with the position of the element as counter
+    uint32_t hi = static_cast<uint32_t>(row);
+    uint32_t lo = static_cast<uint32_t>(col);
+    uint32_t key = seed;
+    for (int round = 0; round < 10; round++) {
+        uint64_t product = static_cast<uint64_t>(0xD256D193u) * hi;
+        hi = static_cast<uint32_t>(product >> 32) ^ key ^ lo;
+        lo = static_cast<uint32_t>(product);
+        key += 0x9E3779B9u;
+    }
+    // Use the upper 24 bit to get a value that can be represented exactly
+    return static_cast<DATA_TYPE>((hi >> 8) * (2.0 / (1 << 24)) - 1.0);
+}
+
+void
+matgen_block(DATA_TYPE* a, ulong lda, ulong row_offset, ulong col_offset,
+             ulong rows, ulong cols, cl_uint seed) {
+    #pragma omp parallel for if (rows * cols > CPU_BLOCK_SIZE * CPU_BLOCK_SIZE)
+    for (ulong i = 0; i < rows; i++) {
+        #pragma omp simd
+        for (ulong j = 0; j < cols; j++) {
+            a[lda * i + j] = matgen_value(seed, row_offset + i,
+                                          col_offset + j);
         }
-        for (int i = n; i < lda; i++) {
-            a[lda*j+i] = 0;
+    }
+}
+
+void
+convertToTileLayout(const DATA_TYPE* a, DATA_TYPE* tiles, ulong n, ulong lda,
+                    uint blockSize) {
+    // Every thread copies whole rows of a, which are split over the blocks
+    // of a block row
+    #pragma omp parallel for
+    for (ulong i = 0; i < n; i++) {
+        ulong tile_row = (i / blockSize) * n * blockSize
+                            + (i % blockSize) * blockSize;
+        for (ulong x = 0; x < n; x += blockSize) {
+            std::copy(a + lda * i + x, a + lda * i + x + blockSize,
+                      tiles + tile_row + x * blockSize);
         }
     }
-    for (int i = 0; i < n; i++) {
-          b[i] = 0.0;
+}
+
+void
+convertFromTileLayout(const DATA_TYPE* tiles, DATA_TYPE* a, ulong n, ulong lda,
+                      uint blockSize) {
+    #pragma omp parallel for
+    for (ulong i = 0; i < n; i++) {
+        ulong tile_row = (i / blockSize) * n * blockSize
+                            + (i % blockSize) * blockSize;
+        for (ulong x = 0; x < n; x += blockSize) {
+            std::copy(tiles + tile_row + x * blockSize,
+                      tiles + tile_row + x * blockSize + blockSize,
+                      a + lda * i + x);
+        }
     }
-    for (int j = 0; j < n; j++) {
-        for (int i = 0; i < n; i++) {
-            b[j] += a[lda*j+i];
+}
+
+/**
+Index of the first element of a row of a block in the layout of the kernels
+
+@param x_block x position of the block
+@param y_block y position of the block
+@param row row within the block
+@param ldaBlocks width of the matrix in blocks
+@param blockSize size of the blocks
+@return the index of the element
+*/
+static ulong
+blockRowIndex(ulong x_block, ulong y_block, ulong row, ulong ldaBlocks,
+              uint blockSize) {
+#if TILE_LAYOUT
+    return ((y_block * ldaBlocks + x_block) * blockSize + row) * blockSize;
+#else
+    return (y_block * blockSize + row) * ldaBlocks * blockSize
+                + x_block * blockSize;
+#endif
+}
+
+/**
+Calculates the index of an element of the matrix in the buffer of its
+memory bank. The buffer of a bank is stored in the layout of the kernels,
+but every block only contains blockSize / bankCount columns.
+
+@param x_block x position of the block
+@param y_block y position of the block
+@param row row within the block
+@param col column within the block
+@param ldaBlocks width of the matrix in blocks
+@param blockSize size of the blocks
+@param bankCount number of memory banks
+@return the index of the element in the buffer of the bank
+*/
+static ulong
+bankIndex(ulong x_block, ulong y_block, ulong row, ulong col,
+          ulong ldaBlocks, uint blockSize, uint bankCount) {
+    ulong width = blockSize / bankCount;
+#if TILE_LAYOUT
+    return ((y_block * ldaBlocks + x_block) * blockSize + row) * width
+                + col / bankCount;
+#else
+    return (y_block * blockSize + row) * ldaBlocks * width + x_block * width
+                + col / bankCount;
+#endif
+}
+
+void
+convertToBankLayout(const DATA_TYPE* a, DATA_TYPE* banks, ulong n,
+                    uint blockSize, uint bankCount) {
+    ulong aSize = n / blockSize;
+    ulong bankSize = n * n / bankCount;
+    #pragma omp parallel for
+    for (ulong y = 0; y < aSize; y++) {
+        for (ulong x = 0; x < aSize; x++) {
+            for (ulong row = 0; row < blockSize; row++) {
+                const DATA_TYPE* src = a + blockRowIndex(x, y, row, aSize,
+                                                         blockSize);
+                for (ulong col = 0; col < blockSize; col++) {
+                    banks[(col % bankCount) * bankSize
+                            + bankIndex(x, y, row, col, aSize, blockSize,
+                                        bankCount)] = src[col];
+                }
+            }
         }
     }
 }
 
+void
+convertFromBankLayout(const DATA_TYPE* banks, DATA_TYPE* a, ulong n,
+                      uint blockSize, uint bankCount) {
+    ulong aSize = n / blockSize;
+    ulong bankSize = n * n / bankCount;
+    #pragma omp parallel for
+    for (ulong y = 0; y < aSize; y++) {
+        for (ulong x = 0; x < aSize; x++) {
+            for (ulong row = 0; row < blockSize; row++) {
+                DATA_TYPE* dst = a + blockRowIndex(x, y, row, aSize,
+                                                   blockSize);
+                for (ulong col = 0; col < blockSize; col++) {
+                    dst[col] = banks[(col % bankCount) * bankSize
+                                + bankIndex(x, y, row, col, aSize, blockSize,
+                                            bankCount)];
+                }
+            }
+        }
+    }
+}
+
+void matgen(DATA_TYPE* a, cl_int lda, cl_int n, DATA_TYPE* b,
+            DATA_TYPE* norma, cl_uint seed) {
+    DATA_TYPE max_val = 0.0;
+    // Every row is generated and summed up by a single thread, so the
+    // results are independent of the number of threads
+    #pragma omp parallel for reduction(max:max_val)
+    for (int i = 0; i < n; i++) {
+        DATA_TYPE row_sum = 0.0;
+        #pragma omp simd
+        for (int j = 0; j < n; j++) {
+            a[lda*i+j] = matgen_value(seed, i, j);
+        }
+        for (int j = 0; j < n; j++) {
+            max_val = (a[lda*i+j] > max_val) ? a[lda*i+j] : max_val;
+            row_sum += a[lda*i+j];
+        }
+        for (int j = n; j < lda; j++) {
+            a[lda*i+j] = 0;
+        }
+        b[i] = row_sum;
+    }
+    *norma = max_val;
+}
+
 /**
 Standard LU factorization on a block with fixed size
 
@@ -223,43 +1179,245 @@ gefa_ref(DATA_TYPE* a, ulong n, ulong lda, int* ipvt) {
     }
 }
 
+/**
+Blocked LU factorization with partial pivoting
+
+The panel is factorized with row swaps over the whole panel width, such that
+the multipliers are consistent for the trailing update.
+After the update, the row swaps are reverted on the multipliers to get the
+storage format of gefa_ref.
+*/
 void
-gesl_ref(DATA_TYPE* a, DATA_TYPE* b, cl_int* ipvt, ulong n, uint lda) {
-    DATA_TYPE* b_tmp = new DATA_TYPE[n];
+gefa_ref_blocked(DATA_TYPE* a, ulong n, ulong lda, int* ipvt) {
+    // For each panel of CPU_BLOCK_SIZE columns
+    for (ulong k0 = 0; k0 < n; k0 += CPU_BLOCK_SIZE) {
+        ulong k1 = std::min(k0 + CPU_BLOCK_SIZE, n);
 
-    for (int k = 0; k < n; k++) {
-        b_tmp[k] = b[k];
+        // Factorize the panel
+        for (ulong k = k0; k < k1; k++) {
+            DATA_TYPE max_val = fabs(a[k * lda + k]);
+            ulong pvt_index = k;
+            for (ulong i = k + 1; i < n; i++) {
+                if (max_val < fabs(a[i * lda + k])) {
+                    pvt_index = i;
+                    max_val = fabs(a[i * lda + k]);
+                }
+            }
+            ipvt[k] = pvt_index;
+            if (pvt_index != k) {
+                for (ulong j = k0; j < k1; j++) {
+                    DATA_TYPE tmp_val = a[k * lda + j];
+                    a[k * lda + j] = a[pvt_index * lda + j];
+                    a[pvt_index * lda + j] = tmp_val;
+                }
+            }
+
+            DATA_TYPE scale = -1.0 / a[k * lda + k];
+            // Scale the elements below the diagonal and update the remaining
+            // columns of the panel
+            #pragma omp parallel for if (n - k > CPU_BLOCK_SIZE * CPU_BLOCK_SIZE)
+            for (ulong i = k + 1; i < n; i++) {
+                DATA_TYPE a_ik = a[i * lda + k] * scale;
+                a[i * lda + k] = a_ik;
+                #pragma omp simd
+                for (ulong j = k + 1; j < k1; j++) {
+                    a[i * lda + j] += a_ik * a[k * lda + j];
+                }
+            }
+        }
+
+        if (k1 < n) {
+            // Apply the row swaps to the columns right of the panel and
+            // calculate the top block row of U
+            #pragma omp parallel for
+            for (ulong j0 = k1; j0 < n; j0 += CPU_BLOCK_SIZE) {
+                ulong j1 = std::min(j0 + CPU_BLOCK_SIZE, n);
+                for (ulong k = k0; k < k1; k++) {
+                    ulong pvt_index = ipvt[k];
+                    if (pvt_index != k) {
+                        for (ulong j = j0; j < j1; j++) {
+                            DATA_TYPE tmp_val = a[k * lda + j];
+                            a[k * lda + j] = a[pvt_index * lda + j];
+                            a[pvt_index * lda + j] = tmp_val;
+                        }
+                    }
+                }
+                for (ulong k = k0; k < k1; k++) {
+                    for (ulong i = k + 1; i < k1; i++) {
+                        DATA_TYPE a_ik = a[i * lda + k];
+                        #pragma omp simd
+                        for (ulong j = j0; j < j1; j++) {
+                            a[i * lda + j] += a_ik * a[k * lda + j];
+                        }
+                    }
+                }
+            }
+
+            // Update the trailing matrix tile by tile
+            #pragma omp parallel for collapse(2) schedule(dynamic)
+            for (ulong i0 = k1; i0 < n; i0 += CPU_BLOCK_SIZE) {
+                for (ulong j0 = k1; j0 < n; j0 += CPU_BLOCK_SIZE) {
+                    ulong i1 = std::min(i0 + CPU_BLOCK_SIZE, n);
+                    ulong j1 = std::min(j0 + CPU_BLOCK_SIZE, n);
+                    for (ulong i = i0; i < i1; i++) {
+                        for (ulong k = k0; k < k1; k++) {
+                            DATA_TYPE a_ik = a[i * lda + k];
+                            #pragma omp simd
+                            for (ulong j = j0; j < j1; j++) {
+                                a[i * lda + j] += a_ik * a[k * lda + j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // Revert the row swaps on the multipliers of the previous columns
+        // in the panel
+        for (ulong k = k1 - 1; k > k0; k--) {
+            ulong pvt_index = ipvt[k];
+            if (pvt_index != k) {
+                for (ulong j = k0; j < k; j++) {
+                    DATA_TYPE tmp_val = a[k * lda + j];
+                    a[k * lda + j] = a[pvt_index * lda + j];
+                    a[pvt_index * lda + j] = tmp_val;
+                }
+            }
+        }
     }
+}
 
+void
+gesl_ref(DATA_TYPE* a, DATA_TYPE* b, cl_int* ipvt, ulong n, uint lda) {
     // solve l*y = b
     // For each row in matrix
     for (int k = 0; k < n-1; k++) {
         if (ipvt[k] != k) {
-            DATA_TYPE tmp = b_tmp[k];
-            b_tmp[k] = b_tmp[ipvt[k]];
-            b_tmp[ipvt[k]] = tmp;
+            DATA_TYPE tmp = b[k];
+            b[k] = b[ipvt[k]];
+            b[ipvt[k]] = tmp;
         }
         // For each row below add
         for (int i = k+1; i < n; i++) {
             // add solved upper row to current row
-            b_tmp[i] += b_tmp[k] * a[lda*i + k];
+            b[i] += b[k] * a[lda*i + k];
         }
     }
 
     // now solve  u*x = y
 
     for (int k = n-1; k >= 0; k--) {
-        b_tmp[k] = b_tmp[k]/a[lda*k + k];
+        b[k] = b[k]/a[lda*k + k];
         for (int i = 0; i < k; i++) {
-            b_tmp[i] -= b_tmp[k] * a[lda*i + k];
+            b[i] -= b[k] * a[lda*i + k];
+        }
+    }
+}
+
+/**
+Swap the multipliers of the rows k and ipvt[k] left of column k for all rows.
+Applied in ascending order, this converts the multipliers stored by gefa into
+a lower triangular matrix L with P*A = L*U. Applied in descending order,
+the conversion is reverted.
+*/
+static void
+permute_multipliers(DATA_TYPE* a, cl_int* ipvt, ulong n, ulong lda,
+                    bool ascending) {
+    for (ulong i = 0; i < n; i++) {
+        ulong k = ascending ? i : n - 1 - i;
+        ulong pvt_index = ipvt[k];
+        if (pvt_index != k) {
+            for (ulong j = 0; j < k; j++) {
+                DATA_TYPE tmp_val = a[k * lda + j];
+                a[k * lda + j] = a[pvt_index * lda + j];
+                a[pvt_index * lda + j] = tmp_val;
+            }
         }
     }
+}
 
-    for (int k = 0; k < n; k++) {
-        b[k] = b_tmp[k];
+void
+gesl_ref_blocked(DATA_TYPE* a, DATA_TYPE* b, cl_int* ipvt, ulong n,
+                 ulong lda, ulong nrhs, ulong ldb) {
+    permute_multipliers(a, ipvt, n, lda, true);
+
+    // Apply all row swaps to the right-hand sides
+    #pragma omp parallel for
+    for (ulong r = 0; r < nrhs; r++) {
+        DATA_TYPE* b_r = b + r * ldb;
+        for (ulong k = 0; k < n; k++) {
+            DATA_TYPE tmp = b_r[k];
+            b_r[k] = b_r[ipvt[k]];
+            b_r[ipvt[k]] = tmp;
+        }
     }
 
-    delete b_tmp;
+    // solve l*y = b
+    // For each block of rows from top to bottom
+    for (ulong i0 = 0; i0 < n; i0 += CPU_BLOCK_SIZE) {
+        ulong i1 = std::min(i0 + CPU_BLOCK_SIZE, n);
+        // Add the already solved upper rows to the rows of the block
+        #pragma omp parallel for
+        for (ulong i = i0; i < i1; i++) {
+            for (ulong r = 0; r < nrhs; r++) {
+                DATA_TYPE* b_r = b + r * ldb;
+                DATA_TYPE sum = 0.0;
+                #pragma omp simd reduction(+:sum)
+                for (ulong k = 0; k < i0; k++) {
+                    sum += a[i * lda + k] * b_r[k];
+                }
+                b_r[i] += sum;
+            }
+        }
+        // Solve the diagonal block
+        #pragma omp parallel for
+        for (ulong r = 0; r < nrhs; r++) {
+            DATA_TYPE* b_r = b + r * ldb;
+            for (ulong i = i0 + 1; i < i1; i++) {
+                DATA_TYPE sum = 0.0;
+                #pragma omp simd reduction(+:sum)
+                for (ulong k = i0; k < i; k++) {
+                    sum += a[i * lda + k] * b_r[k];
+                }
+                b_r[i] += sum;
+            }
+        }
+    }
+
+    // now solve  u*x = y
+    // For each block of rows from bottom to top
+    for (ulong i1 = n; i1 > 0; i1 = (i1 > CPU_BLOCK_SIZE) ?
+                                        i1 - CPU_BLOCK_SIZE : 0) {
+        ulong i0 = (i1 > CPU_BLOCK_SIZE) ? i1 - CPU_BLOCK_SIZE : 0;
+        // Subtract the already solved lower rows from the rows of the block
+        #pragma omp parallel for
+        for (ulong i = i0; i < i1; i++) {
+            for (ulong r = 0; r < nrhs; r++) {
+                DATA_TYPE* b_r = b + r * ldb;
+                DATA_TYPE sum = 0.0;
+                #pragma omp simd reduction(+:sum)
+                for (ulong k = i1; k < n; k++) {
+                    sum += a[i * lda + k] * b_r[k];
+                }
+                b_r[i] -= sum;
+            }
+        }
+        // Solve the diagonal block
+        #pragma omp parallel for
+        for (ulong r = 0; r < nrhs; r++) {
+            DATA_TYPE* b_r = b + r * ldb;
+            for (ulong i = i1; i > i0; i--) {
+                DATA_TYPE sum = 0.0;
+                #pragma omp simd reduction(+:sum)
+                for (ulong k = i; k < i1; k++) {
+                    sum += a[(i - 1) * lda + k] * b_r[k];
+                }
+                b_r[i - 1] = (b_r[i - 1] - sum) / a[(i - 1) * lda + i - 1];
+            }
+        }
+    }
+
+    permute_multipliers(a, ipvt, n, lda, false);
 }
 
 void dmxpy(int n1, DATA_TYPE* y, int n2, int ldm, DATA_TYPE* x, DATA_TYPE* m) {
@@ -272,47 +1430,263 @@ void dmxpy(int n1, DATA_TYPE* y, int n2, int ldm, DATA_TYPE* x, DATA_TYPE* m) {
 }
 
 double
-checkLINPACKresults(DATA_TYPE* b_res, cl_int lda, cl_int n) {
-    DATA_TYPE* a = new DATA_TYPE[lda*n];
-    DATA_TYPE norma = 0;
-    DATA_TYPE* x = new DATA_TYPE[n];
-    DATA_TYPE* b = new DATA_TYPE[n];
-    /*     compute a residual to verify results.  */
-
-    for (int i = 0; i < n; i++) {
-        x[i] = b_res[i];
-        b[i] = b_res[i];
-    }
-
-    matgen(a, lda, n, b, &norma);
-    for (int i = 0; i < n; i++) {
-        b[i] = -b[i];
-    }
-    dmxpy(n, b, n, lda, x, a);
+checkLINPACKresults(DATA_TYPE* b_res, cl_int lda, cl_int n, ulong rows,
+                    cl_uint seed) {
+    ulong checked_rows = (rows > 0 && rows < n) ? rows : n;
+    DATA_TYPE norma = 0.0;
     DATA_TYPE resid = 0.0;
     DATA_TYPE normx = 0.0;
+    /*     compute a residual to verify results.  */
 
+    // Regenerate the checked rows of the matrix one after another and
+    // calculate the sum of the row and the residual in a single pass
+    #pragma omp parallel reduction(max:norma,resid)
+    {
+        std::vector<DATA_TYPE> a_row(n);
+        #pragma omp for
+        for (ulong s = 0; s < checked_rows; s++) {
+            ulong i = s * n / checked_rows;
+            matgen_block(a_row.data(), n, i, 0, 1, n, seed);
+            DATA_TYPE b_i = 0.0;
+            for (int j = 0; j < n; j++) {
+                norma = (a_row[j] > norma) ? a_row[j] : norma;
+                b_i += a_row[j];
+            }
+            DATA_TYPE r_i = -b_i;
+            for (int j = 0; j < n; j++) {
+                r_i = r_i + b_res[j] * a_row[j];
+            }
+            resid = (resid > fabs(r_i)) ? resid : fabs(r_i);
+        }
+    }
     for (int i = 0; i < n; i++) {
-        resid = (resid > fabs(b[i])) ? resid : fabs(b[i]);
-        normx = (normx > fabs(x[i])) ? normx : fabs(x[i]);
+        normx = (normx > fabs(b_res[i])) ? normx : fabs(b_res[i]);
     }
 
     DATA_TYPE eps = epslon(static_cast<DATA_TYPE>(1.0));
     DATA_TYPE residn = resid / (n*norma*normx*eps);
 
+    if (checked_rows < n) {
+        std::cout << "Residual calculated over " << checked_rows << " of "
+                  << n << " rows" << std::endl;
+    }
     std::cout << "  norm. resid        resid       "\
                  "machep       x[0]-1     x[n-1]-1" << std::endl;
     std::cout << std::setw(ENTRY_SPACE) << residn << std::setw(ENTRY_SPACE)
               << resid << std::setw(ENTRY_SPACE) << eps
-              << std::setw(ENTRY_SPACE) << x[0]-1 << std::setw(ENTRY_SPACE)
-              << x[n-1]-1 << std::endl;
+              << std::setw(ENTRY_SPACE) << b_res[0]-1 << std::setw(ENTRY_SPACE)
+              << b_res[n-1]-1 << std::endl;
+
+    return residn;
+}
+
+double
+checkLUfactorization(DATA_TYPE* lu, cl_int* ipvt, ulong lda, ulong n,
+                     cl_uint seed) {
+    ulong probes = VERIFY_PROBES;
+    std::vector<DATA_TYPE> r(n * probes);
+    std::vector<double> y(n * probes);
+    std::vector<double> w(n * probes);
+    DATA_TYPE norma = 0.0;
+
+    // Create random probe vectors with values +-1
+    for (ulong p = 0; p < probes; p++) {
+        for (ulong i = 0; i < n; i++) {
+            r[p * n + i] = (matgen_value(seed + 1, p, i) < 0) ? -1.0 : 1.0;
+        }
+    }
+
+    // The products are accumulated in double precision, so the result
+    // mainly shows the error of the factorization itself.
+    // Calculate Y = A*R with a single pass over the regenerated rows of A
+    #pragma omp parallel reduction(max:norma)
+    {
+        std::vector<DATA_TYPE> a_row(n);
+        #pragma omp for
+        for (ulong i = 0; i < n; i++) {
+            matgen_block(a_row.data(), n, i, 0, 1, n, seed);
+            for (ulong j = 0; j < n; j++) {
+                norma = (a_row[j] > norma) ? a_row[j] : norma;
+            }
+            for (ulong p = 0; p < probes; p++) {
+                double sum = 0.0;
+                #pragma omp simd reduction(+:sum)
+                for (ulong j = 0; j < n; j++) {
+                    sum += a_row[j] * r[p * n + j];
+                }
+                y[p * n + i] = sum;
+            }
+        }
+    }
+
+    // Apply the row swaps to get P*A*R
+    for (ulong p = 0; p < probes; p++) {
+        for (ulong k = 0; k < n; k++) {
+            double tmp = y[p * n + k];
+            y[p * n + k] = y[p * n + ipvt[k]];
+            y[p * n + ipvt[k]] = tmp;
+        }
+    }
+
+    permute_multipliers(lu, ipvt, n, lda, true);
+
+    // Calculate W = U*R
+    #pragma omp parallel for
+    for (ulong i = 0; i < n; i++) {
+        for (ulong p = 0; p < probes; p++) {
+            double sum = 0.0;
+            #pragma omp simd reduction(+:sum)
+            for (ulong k = i; k < n; k++) {
+                sum += lu[i * lda + k] * r[p * n + k];
+            }
+            w[p * n + i] = sum;
+        }
+    }
+
+    // Calculate L*W and the difference to P*A*R.
+    // The multipliers are stored negated.
+    double resid = 0.0;
+    #pragma omp parallel for reduction(max:resid)
+    for (ulong i = 0; i < n; i++) {
+        for (ulong p = 0; p < probes; p++) {
+            double sum = 0.0;
+            #pragma omp simd reduction(+:sum)
+            for (ulong k = 0; k < i; k++) {
+                sum += lu[i * lda + k] * w[p * n + k];
+            }
+            double diff = fabs(y[p * n + i] - (w[p * n + i] - sum));
+            resid = (resid > diff) ? resid : diff;
+        }
+    }
+
+    permute_multipliers(lu, ipvt, n, lda, false);
+
+    DATA_TYPE eps = epslon(static_cast<DATA_TYPE>(1.0));
+    double residn = resid / (n*norma*eps);
+
+    std::cout << "Randomized check of the LU factorization with " << probes
+              << " probe vectors:" << std::endl;
+    std::cout << "  norm. resid        resid       machep" << std::endl;
+    std::cout << std::setw(ENTRY_SPACE) << residn << std::setw(ENTRY_SPACE)
+              << resid << std::setw(ENTRY_SPACE) << eps << std::endl;
 
-    delete a;
-    delete x;
-    delete b;
     return residn;
 }
 
+std::shared_ptr<bm_execution::RefinementResults>
+refineSolution(DATA_TYPE* lu, cl_int* ipvt, ulong lda, ulong n,
+               uint maxIterations, cl_uint seed) {
+    // Double precision copy of the matrix and the right-hand side
+    std::vector<double> a(n * n);
+    std::vector<double> b(n);
+    double norma = 0.0;
+    #pragma omp parallel for reduction(max:norma)
+    for (ulong i = 0; i < n; i++) {
+        double b_i = 0.0;
+        double row_norm = 0.0;
+        for (ulong j = 0; j < n; j++) {
+            a[i * n + j] = matgen_value(seed, i, j);
+            b_i += a[i * n + j];
+            row_norm += fabs(a[i * n + j]);
+        }
+        b[i] = b_i;
+        norma = (norma > row_norm) ? norma : row_norm;
+    }
+
+    std::vector<double> x(n, 0.0);
+    std::vector<double> previousX(n);
+    std::vector<double> r(b);
+    std::vector<DATA_TYPE> correction(n);
+    double eps = std::numeric_limits<double>::epsilon();
+    double residn = std::numeric_limits<double>::max();
+    double previousResidn = residn;
+    bool stagnated = false;
+    uint iteration = 0;
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto tSolve = t1;
+    while (true) {
+        // Solve the correction in single precision. In the first iteration,
+        // the residual is equal to b.
+        for (ulong i = 0; i < n; i++) {
+            correction[i] = static_cast<DATA_TYPE>(r[i]);
+        }
+        gesl_ref_blocked(lu, correction.data(), ipvt, n, lda, 1, n);
+        for (ulong i = 0; i < n; i++) {
+            x[i] += correction[i];
+        }
+        if (iteration == 0) {
+            tSolve = std::chrono::high_resolution_clock::now();
+        }
+
+        // Calculate residual r = b - A*x in double precision
+        double resid = 0.0;
+        double normx = 0.0;
+        #pragma omp parallel for reduction(max:resid)
+        for (ulong i = 0; i < n; i++) {
+            double sum = 0.0;
+            #pragma omp simd reduction(+:sum)
+            for (ulong j = 0; j < n; j++) {
+                sum += a[i * n + j] * x[j];
+            }
+            r[i] = b[i] - sum;
+            resid = (resid > fabs(r[i])) ? resid : fabs(r[i]);
+        }
+        for (ulong i = 0; i < n; i++) {
+            normx = (normx > fabs(x[i])) ? normx : fabs(x[i]);
+        }
+        residn = resid / (norma * normx * n * eps);
+        // The refinement is stopped if the residual does not decrease
+        // anymore. The previous solution is kept, because it is more
+        // accurate.
+        if (residn >= previousResidn) {
+            x.swap(previousX);
+            residn = previousResidn;
+            stagnated = true;
+            iteration--;
+            break;
+        }
+        if (residn < REFINEMENT_THRESHOLD || iteration >= maxIterations) {
+            break;
+        }
+        previousX = x;
+        previousResidn = residn;
+        iteration++;
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> solveTime =
+        std::chrono::duration_cast<std::chrono::duration<double>>
+                                                            (tSolve - t1);
+    std::chrono::duration<double> timespan =
+        std::chrono::duration_cast<std::chrono::duration<double>>
+                                                            (t2 - tSolve);
+
+    std::cout << "Mixed-precision iterative refinement:" << std::endl;
+    std::cout << "   iterations  norm. resid       machep       x[0]-1"\
+                 "     x[n-1]-1" << std::endl;
+    std::cout << std::setw(ENTRY_SPACE) << iteration
+              << std::setw(ENTRY_SPACE) << residn
+              << std::setw(ENTRY_SPACE) << eps
+              << std::setw(ENTRY_SPACE) << x[0]-1
+              << std::setw(ENTRY_SPACE) << x[n-1]-1 << std::endl;
+    if (residn >= REFINEMENT_THRESHOLD && stagnated) {
+        std::cerr << "Refinement did not reach the threshold of "
+                  << REFINEMENT_THRESHOLD << ", because the residual did "
+                  << "not decrease anymore!" << std::endl;
+    } else if (residn >= REFINEMENT_THRESHOLD) {
+        std::cerr << "Refinement did not reach the threshold of "
+                  << REFINEMENT_THRESHOLD << " within " << maxIterations
+                  << " iterations!" << std::endl;
+    }
+
+    std::shared_ptr<bm_execution::RefinementResults> results(
+                    new bm_execution::RefinementResults{iteration,
+                                                        timespan.count(),
+                                                        solveTime.count(),
+                                                        residn});
+    return results;
+}
+
 DATA_TYPE epslon(DATA_TYPE x) {
     DATA_TYPE a, b, c, eps;
 
@@ -326,48 +1700,3 @@ DATA_TYPE epslon(DATA_TYPE x) {
     return (eps*fabs(static_cast<double>(x)));
 }
 
-
-/**
-The program entry point.
-Prepares the FPGA and executes the kernels on the device.
-*/
-int main(int argc, char * argv[]) {
-    // Setup benchmark
-    std::shared_ptr<ProgramSettings> programSettings =
-                                            parseProgramParameters(argc, argv);
-    fpga_setup::setupEnvironmentAndClocks();
-    std::vector<cl::Device> usedDevice =
-                        fpga_setup::selectFPGADevice(programSettings->platform,
-                                                     programSettings->device);
-    cl::Context context = cl::Context(usedDevice);
-    const char* usedKernel = programSettings->kernelFileName.c_str();
-    cl::Program program = fpga_setup::fpgaSetup(context, usedDevice,
-                                                            usedKernel);
-
-    // Give setup summary
-    std::cout << "Summary:" << std::endl
-              << "Kernel Repetitions:  " << programSettings->numRepetitions
-              << std::endl
-              << "Block size:          " << programSettings->blockSize
-              << std::endl
-              << "Total matrix size:   " << programSettings->matrixSize
-              << std::endl
-              << "Memory Interleaving: " << programSettings->useMemInterleaving
-              << std::endl
-              << "Kernel file:         " << programSettings->kernelFileName
-              << std::endl
-              << "Device:              "
-              << usedDevice[0].getInfo<CL_DEVICE_NAME>() << std::endl
-              << HLINE
-              << "Start benchmark using the given configuration." << std::endl
-              << HLINE;
-
-    // Start actual benchmark
-    auto results = bm_execution::calculate(context, usedDevice[0], program,
-              programSettings->numRepetitions, programSettings->matrixSize,
-              programSettings->blockSize);
-
-    printResults(results, programSettings->matrixSize);
-
-    return 0;
-}
@@ -24,6 +24,8 @@ SOFTWARE.
 
 /* C++ standard library headers */
 #include <memory>
+#include <string>
+#include <vector>
 
 /* Project's headers */
 #include "src/host/execution.h"
@@ -41,6 +43,40 @@ Number of times the execution of the benchmark will be repeated.
 #define NTIMES 1
 #endif
 
+/*
+Number of replicated C4 units in the kernel. Only used by the
+blocked_pvt_channel kernel.
+*/
+#ifndef REPLICATIONS
+#define REPLICATIONS 1
+#endif
+
+/*
+If set to 1, the kernels with pivoting expect every block of the matrix to
+be stored contiguously in global memory. The host converts the matrix
+before and after the transfer.
+*/
+#ifndef TILE_LAYOUT
+#define TILE_LAYOUT 0
+#endif
+
+/**
+Number of memory banks the blocked_pvt kernel distributes the matrix over.
+The columns of every block are distributed round-robin over one buffer per
+bank.
+*/
+#ifndef MEMORY_BANKS
+#define MEMORY_BANKS 1
+#endif
+
+/**
+If 1, the gefa kernel of blocked_pvt counts the processed blocks and cycles
+of its stages and the host prints a breakdown of them.
+*/
+#ifndef STAGE_COUNTERS
+#define STAGE_COUNTERS 0
+#endif
+
 /*
 The data type used for the random accesses.
 Note that it should be big enough to address the whole data array. Moreover it
@@ -58,16 +94,105 @@ The full name will be
 */
 #define GEFA_KERNEL "gefa"
 
+/*
+Name of the kernel that solves the linear equations using the LU
+factorization. Only available for kernels with pivoting.
+*/
+#define GESL_KERNEL "gesl"
+
+/*
+Seed of the random number generator that is used to generate the matrix.
+*/
+#ifndef MATGEN_SEED
+#define MATGEN_SEED 7
+#endif
+
+/*
+Width of the panels and size of the tiles used by the blocked CPU
+implementation of the LU factorization.
+*/
+#ifndef CPU_BLOCK_SIZE
+#define CPU_BLOCK_SIZE 64
+#endif
+
+/*
+Number of random probe vectors that are used for the fast verification of
+the LU factorization.
+*/
+#ifndef VERIFY_PROBES
+#define VERIFY_PROBES 3
+#endif
+
+/*
+Maximum normalized residual error in double precision that has to be reached
+by the iterative refinement of the solution. The value is taken from HPL.
+*/
+#ifndef REFINEMENT_THRESHOLD
+#define REFINEMENT_THRESHOLD 16.0
+#endif
+
+/*
+Unrolling of the global memory accesses in the kernels. It is used to
+record the build configuration in the results and by the performance model.
+*/
+#ifndef GLOBAL_MEM_UNROLL
+#define GLOBAL_MEM_UNROLL 16
+#endif
+
+/*
+Type of the kernel and number of blocks of the left panel in the gefa kernel
+of blocked_pvt. They are set by the Makefile and select the block schedule
+that is replayed by the performance model.
+*/
+#ifndef KERNEL_TYPE
+#define KERNEL_TYPE "blocked_pvt"
+#endif
+
+#ifndef PANEL_BLOCKS
+#define PANEL_BLOCKS 0
+#endif
+
 #define ENTRY_SPACE 13
 
+/**
+Formats that can be used to write the results of the benchmark to a file
+additionally to the output on stdout.
+*/
+enum class OutputFormat {
+    // Only print the results to stdout
+    text,
+    json,
+    csv
+};
+
 struct ProgramSettings {
     uint numRepetitions;
+    uint numReplications;
     uint blockSize;
     size_t matrixSize;
     bool useMemInterleaving;
     int device;
     int platform;
     std::string kernelFileName;
+    bm_execution::VerificationMode verificationMode;
+    ulong verificationRows;
+    uint refinementIterations;
+    bool pipelined;
+    uint warmupIterations;
+    OutputFormat outputFormat;
+    std::string outputFile;
+    std::vector<size_t> sweepSizes;
+    std::string servicePath;
+    ulong serviceMaxSize;
+    uint serviceMaxRhs;
+    uint batchSize;
+    uint inFlight;
+    uint jobs;
+    bool zeroCopy;
+    uint streamBlocks;
+    double fmax;
+    double bandwidth;
+    double c4Throughput;
 };
 
 
@@ -79,6 +204,17 @@ Supports the following parameters:
     - number of kernel replications (-r)
     - data size (-d)
     - use memory interleaving
+    - verification mode (--verify) and number of checked rows (--verify-rows)
+    - maximum number of iterations to refine the solution (--refine)
+    - overlap the data generation with the kernel execution (--pipelined)
+    - number of warm-up repetitions (-w)
+    - format (--output-format) and path (--output-file) of the result file
+    - matrix sizes of a sweep (--sweep)
+    - socket path of the solver service (--service) and the largest
+      accepted matrix size (--service-max-size) and number of right-hand
+      sides (--service-max-rhs)
+    - clock (--fmax), memory bandwidth (--bandwidth) and C4 throughput
+      (--c4-throughput) of the performance model
 @see https://github.com/jarro2783/cxxopts
 
 @return program settings that are created from the given program arguments
@@ -97,6 +233,21 @@ Can be used in exchange with kernel functions for functionality testing
 */
 void gefa_ref(DATA_TYPE* a, ulong n, ulong lda, int* ipvt);
 
+/**
+Right-looking blocked LU factorization with partial pivoting.
+Panels of CPU_BLOCK_SIZE columns are factorized and the trailing matrix is
+updated tile by tile in parallel using OpenMP.
+The results are stored in the same format as the one of gefa_ref, so the
+output can directly be used by gesl_ref.
+
+@param a the matrix with size of n*n
+@param n size of matrix A
+@param lda row with of the matrix. must be >=n
+@param ipvt vector that will contain the pivoting information
+
+*/
+void gefa_ref_blocked(DATA_TYPE* a, ulong n, ulong lda, int* ipvt);
+
 /**
 Solve linear equations using its LU decomposition.
 Therefore solves A*x = b by solving L*y = b and then U*x = y with A = LU
@@ -112,13 +263,92 @@ where A is a matrix of size n*n
 void gesl_ref(DATA_TYPE* a, DATA_TYPE* b, cl_int* ipvt, ulong n, uint lda);
 
 /**
-Print the benchmark results to stdout
+Blocked solver for multiple right-hand sides using the LU decomposition.
+Solves A*X = B by applying all row swaps to B at once and then solving
+L*Y = B and U*X = Y block-wise with vectorized and parallel inner loops.
+The multipliers in a are temporarily permuted during the calculation and
+restored before the function returns.
+
+@param a the matrix a in LU representation calculated by gefa call
+@param b n*nrhs matrix B of the given equation. Every right-hand side is
+         stored contiguously. Will be overwritten with the solution X.
+@param ipvt vector containing pivoting information
+@param n size of matrix A
+@param lda row with of the matrix. must be >=n
+@param nrhs number of right-hand sides in b
+@param ldb offset between two right-hand sides in b. must be >=n
+
+*/
+void gesl_ref_blocked(DATA_TYPE* a, DATA_TYPE* b, cl_int* ipvt, ulong n,
+                      ulong lda, ulong nrhs, ulong ldb);
+
+/**
+Calculate the number of floating point operations of the given matrices.
+The factorization with GEFA needs 2n^3/3 and the solution with GESL 2n^2
+operations per matrix.
+
+@param matrixSize size of the matrices
+@param matrices number of matrices
+@param solve if true, the operations of GESL are added
+@return the number of operations in GFLOP
+*/
+double gflopCount(size_t matrixSize, uint matrices, bool solve);
+
+/**
+Write the results of the benchmark to the output file of the settings in
+JSON or CSV format.
+The file contains the time, the GFLOPS and the phase times of every
+repetition, statistics over all repetitions, the program settings and the
+build configuration of the host.
+For a sweep, the results of every matrix size are written.
+
+@param settings the program settings that were used for the execution
+@param deviceName name of the used device
+@param results the results of the benchmark execution for every matrix
+                size of the sweep or only the results for the matrix size
+                of the settings
+*/
+void writeResults(std::shared_ptr<ProgramSettings> settings,
+                  std::string deviceName,
+                  std::vector<std::shared_ptr<bm_execution::ExecutionResults>>
+                                                                    results);
+
+/**
+Print the results of the throughput mode. The throughput is given as the
+number of solved matrices per second and the GFLOPS over all jobs. The
+latencies of the jobs are summarized by their percentiles.
+
+@param results The result struct provided by the throughput call
+@param matrixSize The size of the solved matrices
+*/
+void
+printThroughputResults(std::shared_ptr<bm_execution::ThroughputResults> results,
+                       size_t matrixSize);
+
+/**
+Print a summary of a sweep over multiple matrix sizes to stdout.
+Contains a row with the best and mean time, the GFLOPS and the error for
+every matrix size.
+
+@param matrixSizes the calculated matrix sizes
+@param results the results of the benchmark execution for every matrix size
+*/
+void printSweepResults(const std::vector<size_t>& matrixSizes,
+                const std::vector<std::shared_ptr<bm_execution::ExecutionResults>>&
+                                                                    results);
+
+/**
+Print the benchmark results to stdout.
+If the schedule of the kernel can be replayed by the performance model, the
+measured time of gefa is compared with the predicted time.
 
 @param results the struct containing the results of the benchmark execution
 @param matrixSize size of the calculated matrix
+@param settings the settings of the benchmark and the performance model
 */
 void printResults(std::shared_ptr<bm_execution::ExecutionResults> results,
-                  size_t matrixSize);
+                  size_t matrixSize,
+                  std::shared_ptr<ProgramSettings> settings);
 
 /**
 Generate a matrix using pseudo random numbers with fixed seed.
@@ -130,8 +360,98 @@ A*x = b and x = (1,1, ...,1)
 @param n number of rows in the matrix
 @param b the generated vector that holds the described condition
 @param norma the maximum value in the matrix A that can be used to calculate the residual error
+@param seed seed of the random number generator. Different seeds generate
+            different matrices.
+*/
+void matgen(DATA_TYPE* a, cl_int lda, cl_int n, DATA_TYPE* b, DATA_TYPE* norma,
+            cl_uint seed = MATGEN_SEED);
+
+/**
+Calculate a single element of the matrix generated by matgen.
+A counter-based random number generator (Philox2x32-10) is used, so the value
+is a pure function of the seed and the position of the element.
+This allows to generate the matrix in parallel and to regenerate arbitrary
+parts of it.
+
+@param seed seed of the random number generator
+@param row row of the element in the matrix
+@param col column of the element in the matrix
+@return the value of the element in the range [-1,1)
+*/
+DATA_TYPE matgen_value(cl_uint seed, ulong row, ulong col);
+
+/**
+Generate a sub-block of the matrix generated by matgen.
+The values are exactly the same as the ones generated by matgen.
+
+@param a pointer to the first element of the sub-block
+@param lda width of a row in a
+@param row_offset row of the first element of the sub-block in the matrix
+@param col_offset column of the first element of the sub-block in the matrix
+@param rows number of rows of the sub-block
+@param cols number of columns of the sub-block
+@param seed seed of the random number generator that was used by matgen
+*/
+void matgen_block(DATA_TYPE* a, ulong lda, ulong row_offset, ulong col_offset,
+                  ulong rows, ulong cols, cl_uint seed = MATGEN_SEED);
+
+/**
+Convert a row-major matrix to the tile layout.
+In the tile layout every block of the matrix is stored contiguously and the
+blocks are stored row by row.
+
+@param a the row-major matrix with size of n*lda
+@param tiles buffer for the matrix in tile layout with size of n*n
+@param n size of the matrix. Must be a multiple of the block size.
+@param lda row with of the matrix a. must be >=n
+@param blockSize size of the blocks
 */
-void matgen(DATA_TYPE* a, cl_int lda, cl_int n, DATA_TYPE* b, DATA_TYPE* norma);
+void convertToTileLayout(const DATA_TYPE* a, DATA_TYPE* tiles, ulong n,
+                         ulong lda, uint blockSize);
+
+/**
+Convert a matrix in tile layout back to row-major.
+
+@param tiles the matrix in tile layout with size of n*n
+@param a buffer for the row-major matrix with size of n*lda
+@param n size of the matrix. Must be a multiple of the block size.
+@param lda row with of the matrix a. must be >=n
+@param blockSize size of the blocks
+
+@see convertToTileLayout()
+*/
+void convertFromTileLayout(const DATA_TYPE* tiles, DATA_TYPE* a, ulong n,
+                           ulong lda, uint blockSize);
+
+/**
+Distribute a matrix in the layout of the kernels over the memory banks.
+The columns of every block are distributed round-robin over the banks, so
+column j of a block is stored in bank j % bankCount. Every bank contains an
+n x (n / bankCount) matrix in the layout of the kernels with blocks of
+blockSize / bankCount columns and the banks are stored one after the other.
+
+@param a the matrix in the layout of the kernels with size of n*n
+@param banks buffer for the banks with size of n*n
+@param n size of the matrix. Must be a multiple of the block size.
+@param blockSize size of the blocks
+@param bankCount number of memory banks
+*/
+void convertToBankLayout(const DATA_TYPE* a, DATA_TYPE* banks, ulong n,
+                         uint blockSize, uint bankCount);
+
+/**
+Collect a matrix that is distributed over the memory banks.
+
+@param banks the banks stored one after the other with size of n*n
+@param a buffer for the matrix in the layout of the kernels with size of n*n
+@param n size of the matrix. Must be a multiple of the block size.
+@param blockSize size of the blocks
+@param bankCount number of memory banks
+
+@see convertToBankLayout()
+*/
+void convertFromBankLayout(const DATA_TYPE* banks, DATA_TYPE* a, ulong n,
+                           uint blockSize, uint bankCount);
 
 /**
 Multiply matrix with a vector and add it to another vector.
@@ -140,7 +460,64 @@ Multiply matrix with a vector and add it to another vector.
 */
 void dmxpy (int n1, DATA_TYPE* y, int n2, int ldm, DATA_TYPE* x, DATA_TYPE* m);
 
-double checkLINPACKresults (DATA_TYPE* b_res, cl_int lda, cl_int n);
+/**
+Calculate and print the residual error of the solution.
+The rows of the matrix are regenerated one after another, so the whole
+matrix does not have to be stored.
+
+@param b_res the solution vector x of the equation A*x = b
+@param lda row with of the matrix. must be >=n
+@param n size of matrix A
+@param rows number of evenly distributed rows that are used to calculate the
+            residual. If 0, all rows are used.
+@param seed seed the matrix was generated with
+@return the normalized residual error
+*/
+double checkLINPACKresults (DATA_TYPE* b_res, cl_int lda, cl_int n,
+                            ulong rows, cl_uint seed = MATGEN_SEED);
+
+/**
+Randomized check of the LU factorization of the matrix generated by matgen.
+Checks P*A*R = L*U*R for VERIFY_PROBES random vectors R with values +-1
+(Freivalds' algorithm), which needs O(n^2) operations instead of a complete
+factorization on the CPU.
+The result is printed to stdout.
+
+@param lu the matrix in LU representation calculated by gefa
+@param ipvt vector containing pivoting information
+@param lda row with of the matrix. must be >=n
+@param n size of matrix A
+@param seed seed the matrix was generated with. The probe vectors are
+            generated with the next seed.
+@return the normalized maximum difference between P*A*R and L*U*R
+*/
+double checkLUfactorization(DATA_TYPE* lu, cl_int* ipvt, ulong lda, ulong n,
+                            cl_uint seed = MATGEN_SEED);
+
+/**
+Mixed-precision iterative refinement of the solution for the matrix generated
+by matgen.
+The system is solved with the given LU factors and the residual is calculated
+in double precision using a double precision copy of the matrix. The
+correction is solved again with the LU factors until the normalized residual
+is below REFINEMENT_THRESHOLD, the maximum number of iterations is reached or
+the residual does not decrease anymore. In the last case, the solution of the
+previous step is kept.
+The result is printed to stdout.
+
+@param lu the matrix in LU representation calculated by gefa
+@param ipvt vector containing pivoting information
+@param lda row with of the matrix. must be >=n
+@param n size of matrix A
+@param maxIterations maximum number of refinement steps
+@param seed seed the matrix was generated with
+@return the number of iterations, the time needed for the refinement steps,
+        the time of the first solve and the normalized residual error of the
+        refined solution
+*/
+std::shared_ptr<bm_execution::RefinementResults>
+refineSolution(DATA_TYPE* lu, cl_int* ipvt, ulong lda, ulong n,
+               uint maxIterations, cl_uint seed = MATGEN_SEED);
 
 DATA_TYPE epslon (DATA_TYPE x);
 
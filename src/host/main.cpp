@@ -0,0 +1,207 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* C++ standard library headers */
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+/* External library headers */
+#include "CL/cl.hpp"
+#if QUARTUS_MAJOR_VERSION > 18
+#include "CL/cl_ext_intelfpga.h"
+#endif
+
+/* Project's headers */
+#include "src/host/execution.h"
+#include "src/host/fpga_setup.h"
+#include "src/host/linpack_functionality.h"
+#include "src/host/solver_service.h"
+
+/**
+The program entry point.
+Prepares the FPGA and executes the kernels on the device.
+*/
+int main(int argc, char * argv[]) {
+    // Setup benchmark
+    std::shared_ptr<ProgramSettings> programSettings =
+                                            parseProgramParameters(argc, argv);
+    fpga_setup::setupEnvironmentAndClocks();
+    std::vector<cl::Device> usedDevice;
+    cl::Context context;
+    cl::Program program;
+    fpga_setup::ProgramLoadInfo loadInfo;
+    try {
+        usedDevice = fpga_setup::selectFPGADevice(programSettings->platform,
+                                                  programSettings->device);
+        const char* usedKernel = programSettings->kernelFileName.c_str();
+        program = fpga_setup::fpgaSetup(usedDevice, usedKernel, &context,
+                                        &loadInfo);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+
+    if (!programSettings->servicePath.empty()) {
+        // Solve the jobs of the service with the programmed FPGA
+        std::shared_ptr<bm_execution::ExecutionConfiguration> config(
+                new bm_execution::ExecutionConfiguration {
+                    context, usedDevice[0], program,
+                    programSettings->numRepetitions,
+                    programSettings->numReplications,
+                    programSettings->matrixSize,
+                    programSettings->blockSize,
+                    programSettings->verificationMode,
+                    programSettings->verificationRows,
+                    programSettings->refinementIterations,
+                    programSettings->pipelined,
+                    programSettings->warmupIterations,
+                    programSettings->batchSize,
+                    programSettings->useMemInterleaving,
+                    programSettings->zeroCopy,
+                    programSettings->streamBlocks,
+                    std::make_shared<bm_execution::ExecutionResources>()});
+        std::cout << "Device:              "
+                  << usedDevice[0].getInfo<CL_DEVICE_NAME>() << std::endl
+                  << HLINE;
+        solver_service::run(programSettings->servicePath, config,
+                            programSettings->serviceMaxSize,
+                            programSettings->serviceMaxRhs);
+        return 0;
+    }
+
+    // Give setup summary
+    std::cout << "Summary:" << std::endl
+              << "Kernel Repetitions:  " << programSettings->numRepetitions
+              << std::endl
+              << "Warm-up repetitions: " << programSettings->warmupIterations
+              << std::endl
+              << "Replications:        " << programSettings->numReplications
+              << std::endl
+              << "Block size:          " << programSettings->blockSize
+              << std::endl
+              << "Total matrix size:   ";
+    if (programSettings->sweepSizes.empty()) {
+        std::cout << programSettings->matrixSize;
+    } else {
+        for (size_t size : programSettings->sweepSizes) {
+            std::cout << size << " ";
+        }
+    }
+    std::cout << std::endl
+              << "Memory Interleaving: " << programSettings->useMemInterleaving
+              << std::endl
+              << "Verification:        "
+              << ((programSettings->verificationMode
+                        == bm_execution::VerificationMode::fast) ? "fast"
+                                                                 : "full")
+              << std::endl
+              << "Refinement steps:    "
+              << programSettings->refinementIterations << std::endl
+              << "Pipelined:           " << programSettings->pipelined
+              << std::endl
+              << "Zero-copy:           " << programSettings->zeroCopy
+              << std::endl
+              << "Stream blocks:       " << programSettings->streamBlocks
+              << std::endl;
+    if (programSettings->inFlight > 0) {
+        std::cout << "Jobs in flight:      " << programSettings->inFlight
+                  << std::endl
+                  << "Jobs:                " << programSettings->jobs
+                  << std::endl;
+    }
+    std::cout << "Kernel file:         " << programSettings->kernelFileName
+              << std::endl
+              << "Kernel load time:    " << loadInfo.loadTime << "s"
+              << std::endl
+              << "Programming time:    " << loadInfo.programTime << "s"
+              << (loadInfo.reused ? " (reused)" : "") << std::endl
+              << "Device:              "
+              << usedDevice[0].getInfo<CL_DEVICE_NAME>() << std::endl
+              << HLINE
+              << "Start benchmark using the given configuration." << std::endl
+              << HLINE;
+
+    // A sweep calculates all matrix sizes with the same program. The
+    // kernels and buffers are shared between the executions.
+    bool sweep = !programSettings->sweepSizes.empty();
+    std::vector<size_t> matrixSizes = sweep ? programSettings->sweepSizes
+                        : std::vector<size_t>{programSettings->matrixSize};
+    std::shared_ptr<bm_execution::ExecutionResources> resources(
+                                        new bm_execution::ExecutionResources());
+    std::vector<std::shared_ptr<bm_execution::ExecutionResults>> results;
+
+    for (size_t matrixSize : matrixSizes) {
+        std::shared_ptr<bm_execution::ExecutionConfiguration> config(
+                new bm_execution::ExecutionConfiguration {
+                    context, usedDevice[0], program,
+                    programSettings->numRepetitions,
+                    programSettings->numReplications,
+                    matrixSize,
+                    programSettings->blockSize,
+                    programSettings->verificationMode,
+                    programSettings->verificationRows,
+                    programSettings->refinementIterations,
+                    programSettings->pipelined,
+                    programSettings->warmupIterations,
+                    programSettings->batchSize,
+                    programSettings->useMemInterleaving,
+                    programSettings->zeroCopy,
+                    programSettings->streamBlocks,
+                    resources});
+
+        if (sweep) {
+            std::cout << "Matrix size: " << matrixSize << std::endl;
+        }
+
+        if (programSettings->inFlight > 0) {
+            // Measure the sustained throughput instead of single executions
+            printThroughputResults(bm_execution::throughput(config,
+                                            programSettings->jobs,
+                                            programSettings->inFlight),
+                                   matrixSize);
+            continue;
+        }
+
+        // Start actual benchmark
+        results.push_back(bm_execution::calculate(config));
+
+        printResults(results.back(), matrixSize, programSettings);
+    }
+
+    if (programSettings->inFlight > 0) {
+        return 0;
+    }
+
+    if (sweep) {
+        std::cout << HLINE;
+        printSweepResults(matrixSizes, results);
+    }
+
+    if (programSettings->outputFormat != OutputFormat::text) {
+        writeResults(programSettings,
+                     usedDevice[0].getInfo<CL_DEVICE_NAME>(), results);
+    }
+
+    return 0;
+}
@@ -0,0 +1,383 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+/* Related header files */
+#include "src/host/performance_model.h"
+
+/* C++ standard library headers */
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bm_model {
+
+/**
+Edge length of the sub-blocks that are multiplied in a single cycle by C4 of
+the blocked_pvt kernel. Same as GEMM_BLOCK in lu_blocked_pvt_common.h.
+*/
+static const uint gemmBlock = 8;
+
+/**
+Width of the columns of the printed tables. Same as ENTRY_SPACE of the
+benchmark output.
+*/
+static const int columnWidth = 13;
+
+/**
+Floating point operations that are needed to calculate a single block in the
+given stage. A multiply-add counts as two operations.
+
+@param stage The stage that calculates the block
+@param b The block size
+
+@return The floating point operations of the block
+*/
+static double
+blockFlops(ModelStage stage, double b) {
+    switch (stage) {
+        // Reciprocals of the diagonal, scaling of the columns and update of
+        // the remaining sub-block
+        case c1: return b + b * (b - 1) / 2 + (b - 1) * b * (2 * b - 1) / 3;
+        // Scaling of the columns and update with the top block
+        case c2: return b * b * b;
+        // Update with the unit lower triangle of the diagonal block
+        case c3: return b * b * (b - 1);
+        default: return 2 * b * b * b;
+    }
+}
+
+/**
+Accumulates the operations and cycles of the stages while the block loops
+of gefa are replayed
+*/
+class Replay {
+ public:
+    std::vector<StageModel> stages;
+
+    explicit Replay(const ModelConfiguration& config)
+        : stages(modelStageCount, StageModel{0, 0, 0, 0, 0, 0, 0}),
+          config(config) {
+        double b = config.blockSize;
+        // The inner loops of C1, C2 and C3 are unrolled over a row of the
+        // block, so one row is updated per cycle
+        for (int stage = c1; stage < c4; stage++) {
+            throughput[stage] = 2 * b;
+        }
+        if (config.c4Throughput > 0) {
+            throughput[c4] = config.c4Throughput;
+        } else if (config.schedule == Schedule::blocked) {
+            // The update with a single row of the top block is unrolled
+            throughput[c4] = 2 * b * b;
+        } else {
+            double g = std::min(gemmBlock, config.blockSize);
+            throughput[c4] = 2 * g * g * g;
+        }
+        blockElements = b * b;
+        bytesPerCycle = config.bandwidth * 1.0e3 / config.fmax;
+    }
+
+    /**
+    A block of the stage is loaded, calculated and stored by separate loops
+    that are executed one after the other.
+
+    @param stage The stage of the block
+    @param loads Number of blocks that are loaded for the block
+    @param stores Number of blocks that are stored for the block
+    @param calculate false, if the block is only loaded for the stage
+    */
+    void
+    block(ModelStage stage, ulong loads, ulong stores, bool calculate) {
+        double memory = (loads + stores) * transfer(1);
+        double compute = calculate ? blockFlops(stage, config.blockSize)
+                                        / throughput[stage] : 0;
+        add(stage, loads, stores, calculate, compute, memory,
+            compute + memory);
+    }
+
+    /**
+    A C4 block is calculated while the blocks of the next iteration are
+    loaded and the result of the previous iteration is stored in the same
+    loop, so the transfers overlap with the calculation.
+
+    @param loads Number of blocks that are loaded in the loop
+    @param stores Number of blocks that are stored in the loop
+    */
+    void
+    pipelined(ulong loads, ulong stores) {
+        double memory = transfer(loads + stores);
+        double compute = blockFlops(c4, config.blockSize) / throughput[c4];
+        add(c4, loads, stores, true, compute, memory,
+            std::max(compute, memory));
+    }
+
+    /**
+    @return The floating point operations of C4 per cycle
+    */
+    double
+    peakThroughput() const {
+        return throughput[c4];
+    }
+
+ private:
+    const ModelConfiguration& config;
+    double throughput[modelStageCount];
+    double blockElements;
+    double bytesPerCycle;
+
+    /**
+    Cycles to transfer the given number of blocks with accesses in the same
+    loop. Every access transfers GLOBAL_MEM_UNROLL elements per cycle and
+    all accesses share the memory bandwidth.
+    */
+    double
+    transfer(ulong blocks) {
+        if (blocks == 0) {
+            return 0;
+        }
+        double unrolled = blockElements / config.globalMemUnroll;
+        double limited = blocks * blockElements * config.elementSize
+                         / bytesPerCycle;
+        return std::max(unrolled, limited);
+    }
+
+    void
+    add(ModelStage stage, ulong loads, ulong stores, bool calculate,
+        double compute, double memory, double cycles) {
+        StageModel& s = stages[stage];
+        if (calculate) {
+            s.blocks++;
+            s.flops += blockFlops(stage, config.blockSize);
+        }
+        s.loadedBlocks += loads;
+        s.storedBlocks += stores;
+        s.computeCycles += compute;
+        s.memoryCycles += memory;
+        s.cycles += cycles;
+    }
+};
+
+/**
+Replays the block loops of gefa in lu_blocked.cl
+
+@param replay The replay the blocks are added to
+@param a_size The size of the matrix in blocks
+*/
+static void
+replayBlocked(Replay& replay, long a_size) {
+    for (long diagonal_block = 0; diagonal_block < a_size; diagonal_block++) {
+        replay.block(c1, 1, 1, true);
+        for (long inner_x_block = diagonal_block + 1; inner_x_block < a_size;
+                inner_x_block++) {
+            replay.block(c3, 1, 1, true);
+            for (long inner_y_block = diagonal_block + 1;
+                    inner_y_block < a_size; inner_y_block++) {
+                if (inner_x_block == diagonal_block + 1) {
+                    replay.block(c2, 1, 1, true);
+                } else {
+                    // The left block is loaded again for every inner block
+                    replay.block(c4, 1, 0, false);
+                }
+                replay.block(c4, 1, 1, true);
+            }
+        }
+    }
+}
+
+/**
+Replays the block loops of gefa in lu_blocked_pvt.cl for a single execution
+of the kernel that updates the given range of block rows
+
+@param replay The replay the blocks are added to
+@param a_size The size of the matrix in blocks
+@param row_block_start The first block row that is updated
+@param row_block_end The block row after the last block row that is updated
+@param panel_blocks The PANEL_BLOCKS the kernel is built with
+*/
+static void
+replayBlockedPvt(Replay& replay, long a_size, long row_block_start,
+                 long row_block_end, long panel_blocks) {
+    for (long diagonal_block = 0; diagonal_block < row_block_end;
+            diagonal_block++) {
+        long first_block_row = std::max(diagonal_block + 1, row_block_start);
+        bool update_top = diagonal_block >= row_block_start;
+
+        // Without update, the diagonal block is only loaded for the scale
+        // factors
+        replay.block(c1, 1, update_top ? 1 : 0, update_top);
+
+        if (panel_blocks > 0) {
+            if (update_top && first_block_row >= row_block_end) {
+                for (long inner_x_block = diagonal_block + 1;
+                        inner_x_block < a_size; inner_x_block++) {
+                    replay.block(c3, 1, 1, true);
+                }
+            }
+            for (long chunk_start = first_block_row;
+                    chunk_start < row_block_end; chunk_start += panel_blocks) {
+                long chunk_end = std::min(chunk_start + panel_blocks,
+                                          row_block_end);
+                for (long inner_y_block = chunk_start;
+                        inner_y_block < chunk_end; inner_y_block++) {
+                    replay.block(c2, 1, 1, true);
+                }
+                for (long inner_x_block = diagonal_block + 1;
+                        inner_x_block < a_size; inner_x_block++) {
+                    if (update_top && chunk_start == first_block_row) {
+                        replay.block(c3, 1, 1, true);
+                    } else {
+                        replay.block(c4, 1, 0, false);
+                    }
+                    // First inner block, the following inner blocks and the
+                    // store of the last result
+                    replay.block(c4, 1, 0, false);
+                    for (long inner_y_block = chunk_start;
+                            inner_y_block < chunk_end; inner_y_block++) {
+                        replay.pipelined(inner_y_block + 1 < chunk_end,
+                                         inner_y_block > chunk_start);
+                    }
+                    replay.block(c4, 0, 1, false);
+                }
+            }
+        } else {
+            for (long inner_block = diagonal_block + 1; inner_block < a_size;
+                    inner_block++) {
+                if (update_top) {
+                    replay.block(c3, 1, 1, true);
+                }
+                if (inner_block >= first_block_row
+                        && inner_block < row_block_end) {
+                    replay.block(c2, 1, 1, true);
+                }
+            }
+            for (long inner_x_block = diagonal_block + 1; inner_x_block < a_size
+                        && first_block_row < row_block_end; inner_x_block++) {
+                // Top block, first left and inner block, the following left
+                // and inner blocks and the store of the last result
+                replay.block(c4, 3, 0, false);
+                for (long inner_y_block = first_block_row;
+                        inner_y_block < row_block_end; inner_y_block++) {
+                    replay.pipelined(
+                            (inner_y_block + 1 < row_block_end) ? 2 : 0,
+                            inner_y_block > first_block_row);
+                }
+                replay.block(c4, 0, 1, false);
+            }
+        }
+    }
+}
+
+/*
+ @copydoc bm_model::parseSchedule()
+*/
+bool
+parseSchedule(const std::string& name, Schedule* schedule) {
+    if (name == "blocked") {
+        *schedule = Schedule::blocked;
+    } else if (name == "blocked_pvt") {
+        *schedule = Schedule::blockedPvt;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*
+ @copydoc bm_model::simulate()
+*/
+std::shared_ptr<ModelResults>
+simulate(const ModelConfiguration& config) {
+    Replay replay(config);
+    long a_size = config.matrixSize / config.blockSize;
+
+    if (config.schedule == Schedule::blocked) {
+        replayBlocked(replay, a_size);
+    } else {
+        // In the streaming mode, the kernel is executed for every chunk of
+        // block rows
+        long rows = (config.streamBlocks > 0) ? config.streamBlocks : a_size;
+        for (long start = 0; start < a_size; start += rows) {
+            replayBlockedPvt(replay, a_size, start,
+                             std::min(start + rows, a_size),
+                             config.panelBlocks);
+        }
+    }
+
+    double n = config.matrixSize;
+    double linpackFlops = 2.0 * n * n * n / 3.0;
+    double cycles = 0;
+    double transferred = 0;
+    for (const StageModel& stage : replay.stages) {
+        cycles += stage.cycles;
+        transferred += stage.loadedBlocks + stage.storedBlocks;
+    }
+    double bytes = transferred * config.blockSize * config.blockSize
+                   * config.elementSize;
+    double time = cycles / (config.fmax * 1.0e6);
+
+    // The throughput of C4 is the peak performance of the kernel
+    return std::shared_ptr<ModelResults>(new ModelResults{
+        replay.stages, cycles, time, linpackFlops / time / 1.0e9,
+        replay.peakThroughput() * config.fmax / 1.0e3,
+        linpackFlops / bytes * config.bandwidth});
+}
+
+/*
+ @copydoc bm_model::printModelResults()
+*/
+void
+printModelResults(const ModelConfiguration& config,
+                  const ModelResults& results) {
+    std::vector<std::string> names = {"C1", "C2", "C3", "C4"};
+    std::cout << std::setw(columnWidth) << "stage"
+              << std::setw(columnWidth) << "blocks"
+              << std::setw(columnWidth) << "loaded"
+              << std::setw(columnWidth) << "stored"
+              << std::setw(columnWidth) << "GFLOP"
+              << std::setw(columnWidth) << "cycles"
+              << std::setw(columnWidth) << "share"
+              << std::setw(columnWidth) << "bound" << std::endl;
+    for (int i = 0; i < modelStageCount; i++) {
+        const StageModel& stage = results.stages[i];
+        std::cout << std::setw(columnWidth) << names[i]
+                  << std::setw(columnWidth) << stage.blocks
+                  << std::setw(columnWidth) << stage.loadedBlocks
+                  << std::setw(columnWidth) << stage.storedBlocks
+                  << std::setw(columnWidth) << stage.flops / 1.0e9
+                  << std::setw(columnWidth) << stage.cycles
+                  << std::setw(columnWidth) << stage.cycles / results.cycles
+                  << std::setw(columnWidth)
+                  << ((stage.memoryCycles > stage.computeCycles) ? "memory"
+                                                                 : "compute")
+                  << std::endl;
+    }
+    std::cout << "Predicted gefa:      " << results.time << " s, "
+              << results.gflops << " GFLOPS at " << config.fmax << " MHz"
+              << std::endl
+              << "Roofs:               " << results.computeRoof
+              << " GFLOPS compute, " << results.memoryRoof
+              << " GFLOPS memory at " << config.bandwidth << " GB/s"
+              << std::endl;
+}
+
+}  // namespace bm_model
@@ -0,0 +1,168 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SRC_HOST_PERFORMANCE_MODEL_H_
+#define SRC_HOST_PERFORMANCE_MODEL_H_
+
+/* C++ standard library headers */
+#include <memory>
+#include <string>
+#include <vector>
+
+/* System headers */
+#include <sys/types.h>
+
+/*
+Kernel clock in MHz that is used by the model if no clock is given
+*/
+#ifndef MODEL_FMAX
+#define MODEL_FMAX 300
+#endif
+
+/*
+Bandwidth of the global memory in GB/s that is used by the model if no
+bandwidth is given. The default is the bandwidth of a single DDR4-2400 bank.
+*/
+#ifndef MODEL_BANDWIDTH
+#define MODEL_BANDWIDTH 19.2
+#endif
+
+namespace bm_model {
+
+/**
+The block schedules of the gefa kernels that can be replayed by the model.
+Every schedule corresponds to the kernel with the same TYPE in the Makefile.
+*/
+enum class Schedule {
+    // lu_blocked.cl: all stages are executed one after the other
+    blocked,
+    // lu_blocked_pvt.cl: the transfers of the inner blocks overlap with C4
+    blockedPvt
+};
+
+/**
+Stages of the blocked LU factorization as described by Zhang.
+The order is the same as of the block counters in bm_execution::StageCounter.
+*/
+enum ModelStage {
+    c1,
+    c2,
+    c3,
+    c4,
+    modelStageCount
+};
+
+/**
+Build parameters of the kernel, the problem size and the parameters of the
+hardware that are used by the model.
+The matrix is factorized in chunks of the given number of block rows like
+in the streaming mode of the blocked_pvt kernel, if the number of stream
+blocks is greater than 0. The panel and stream blocks are only used by the
+blocked_pvt schedule.
+If the C4 throughput is 0, it is derived from the C4 implementation of the
+schedule.
+*/
+struct ModelConfiguration {
+    Schedule schedule;
+    size_t matrixSize;
+    uint blockSize;
+    uint globalMemUnroll;
+    uint panelBlocks;
+    uint streamBlocks;
+    uint elementSize;
+    // Kernel clock in MHz
+    double fmax;
+    // Bandwidth of the global memory in GB/s
+    double bandwidth;
+    // Floating point operations of C4 per cycle
+    double c4Throughput;
+};
+
+/**
+The operations and cycles of a single stage of gefa.
+The cycles include the transfers of the blocks from and to global memory.
+The compute cycles only contain the calculation and the memory cycles only
+the transfers of the stage.
+*/
+struct StageModel {
+    ulong blocks;
+    ulong loadedBlocks;
+    ulong storedBlocks;
+    double flops;
+    double computeCycles;
+    double memoryCycles;
+    double cycles;
+};
+
+/**
+Results of the model for a single execution of gefa.
+The stages are indexed by bm_model::ModelStage.
+The GFLOPS are calculated with the LINPACK operation count of the
+factorization. The compute and memory roofs are the GFLOPS that are reached
+if all operations are calculated with the C4 throughput or if all transfers
+of the schedule are limited by the memory bandwidth only.
+*/
+struct ModelResults {
+    std::vector<StageModel> stages;
+    double cycles;
+    double time;
+    double gflops;
+    double computeRoof;
+    double memoryRoof;
+};
+
+/**
+Converts the name of a kernel type to the block schedule of its gefa kernel
+
+@param name Type of the kernel as given to the Makefile
+@param schedule The parsed schedule
+
+@return true, if the kernel type can be replayed by the model
+*/
+bool
+parseSchedule(const std::string& name, Schedule* schedule);
+
+/**
+Replays the block loops of gefa for the given configuration without
+calculating the blocks. Counts the loaded and stored blocks and the
+floating point operations of every stage and predicts the cycles of the
+stages with a roofline of the C4 throughput and the memory bandwidth.
+
+@param config The configuration of the model
+
+@return The predicted operations, cycles and runtime of gefa
+*/
+std::shared_ptr<ModelResults>
+simulate(const ModelConfiguration& config);
+
+/**
+Print the stages and the predicted runtime of the model to stdout
+
+@param config The configuration of the model
+@param results The results of the model
+*/
+void
+printModelResults(const ModelConfiguration& config,
+                  const ModelResults& results);
+
+}  // namespace bm_model
+
+#endif  // SRC_HOST_PERFORMANCE_MODEL_H_
@@ -0,0 +1,217 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* C++ standard library headers */
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* External library headers */
+#include "cxxopts.hpp"
+
+/* Project's headers */
+#include "src/host/performance_model.h"
+
+/*
+Build parameters of the kernel that are used as defaults of the model. They
+are set by the Makefile like for the benchmark.
+*/
+#ifndef KERNEL_TYPE
+#define KERNEL_TYPE "blocked_pvt"
+#endif
+
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 32
+#endif
+
+#ifndef GLOBAL_MEM_UNROLL
+#define GLOBAL_MEM_UNROLL 16
+#endif
+
+#ifndef PANEL_BLOCKS
+#define PANEL_BLOCKS 0
+#endif
+
+#ifndef MATRIX_SIZE
+#define MATRIX_SIZE 1024
+#endif
+
+/**
+Parses a comma separated list of positive numbers and exits the program if
+an entry is invalid.
+
+@param name Name of the option that is parsed
+@param list The comma separated list
+
+@return The numbers of the list
+*/
+static std::vector<uint>
+parseList(const std::string& name, const std::string& list) {
+    std::vector<uint> values;
+    std::stringstream stream(list);
+    std::string entry;
+    while (std::getline(stream, entry, ',')) {
+        std::stringstream value(entry);
+        uint parsed;
+        char rest;
+        if (!(value >> parsed) || value >> rest || parsed == 0) {
+            std::cerr << "Invalid entry of " << name << ": " << entry
+                      << std::endl;
+            exit(1);
+        }
+        values.push_back(parsed);
+    }
+    if (values.empty()) {
+        std::cerr << "No values given for " << name << std::endl;
+        exit(1);
+    }
+    return values;
+}
+
+/**
+The entry point of the performance model.
+Predicts the runtime of gefa for all combinations of the given matrix sizes,
+block sizes and unrolling factors of the global memory accesses without
+synthesizing the kernel.
+*/
+int main(int argc, char * argv[]) {
+    cxxopts::Options options("performance_model",
+        "Replays the block schedule of the gefa kernel and predicts its "\
+        "runtime with a roofline of the C4 throughput and the memory "\
+        "bandwidth");
+    options.add_options()
+        ("t,type", "Kernel type whose schedule is replayed. 'blocked' or "\
+            "'blocked_pvt'",
+            cxxopts::value<std::string>()->default_value(KERNEL_TYPE))
+        ("m,matrix", "Comma separated list of matrix sizes",
+            cxxopts::value<std::string>()->default_value(
+                                            std::to_string(MATRIX_SIZE)))
+        ("b", "Comma separated list of block sizes",
+            cxxopts::value<std::string>()->default_value(
+                                            std::to_string(BLOCK_SIZE)))
+        ("unroll", "Comma separated list of values of GLOBAL_MEM_UNROLL",
+            cxxopts::value<std::string>()->default_value(
+                                        std::to_string(GLOBAL_MEM_UNROLL)))
+        ("panel-blocks", "PANEL_BLOCKS of the blocked_pvt kernel",
+            cxxopts::value<uint>()->default_value(
+                                            std::to_string(PANEL_BLOCKS)))
+        ("stream", "Factorize the matrix in chunks of the given number of "\
+            "block rows like with the --stream option of the benchmark",
+            cxxopts::value<uint>()->default_value(std::to_string(0)))
+        ("fmax", "Kernel clock in MHz",
+            cxxopts::value<double>()->default_value(
+                                            std::to_string(MODEL_FMAX)))
+        ("bandwidth", "Bandwidth of the global memory in GB/s",
+            cxxopts::value<double>()->default_value(
+                                            std::to_string(MODEL_BANDWIDTH)))
+        ("c4-throughput", "Floating point operations of C4 per cycle. If "\
+            "0, it is derived from the C4 implementation of the kernel type",
+            cxxopts::value<double>()->default_value(std::to_string(0)))
+        ("element-size", "Size of a matrix element in bytes",
+            cxxopts::value<uint>()->default_value(std::to_string(4)))
+        ("h,help", "Print this help");
+    cxxopts::ParseResult result = options.parse(argc, argv);
+
+    if (result.count("h")) {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+    bm_model::Schedule schedule;
+    if (!bm_model::parseSchedule(result["t"].as<std::string>(), &schedule)) {
+        std::cerr << "The schedule of the kernel type "
+                  << result["t"].as<std::string>()
+                  << " can not be replayed! Aborting" << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+    if (result["fmax"].as<double>() <= 0
+            || result["bandwidth"].as<double>() <= 0) {
+        std::cerr << "Clock and bandwidth must be positive! Aborting"
+                  << std::endl;
+        std::cout << options.help() << std::endl;
+        exit(1);
+    }
+    std::vector<uint> matrixSizes = parseList("matrix",
+                                        result["m"].as<std::string>());
+    std::vector<uint> blockSizes = parseList("b",
+                                        result["b"].as<std::string>());
+    std::vector<uint> unrolls = parseList("unroll",
+                                        result["unroll"].as<std::string>());
+
+    std::vector<bm_model::ModelConfiguration> configs;
+    for (uint matrixSize : matrixSizes) {
+        for (uint blockSize : blockSizes) {
+            if (matrixSize % blockSize != 0) {
+                std::cerr << "Matrix size " << matrixSize << " is no "
+                          << "multiple of the block size " << blockSize
+                          << "! Aborting" << std::endl;
+                exit(1);
+            }
+            for (uint unroll : unrolls) {
+                configs.push_back(bm_model::ModelConfiguration{schedule,
+                    matrixSize, blockSize, unroll,
+                    result["panel-blocks"].as<uint>(),
+                    result["stream"].as<uint>(),
+                    result["element-size"].as<uint>(),
+                    result["fmax"].as<double>(),
+                    result["bandwidth"].as<double>(),
+                    result["c4-throughput"].as<double>()});
+            }
+        }
+    }
+
+    if (configs.size() == 1) {
+        std::cout << "Matrix size:         " << configs[0].matrixSize
+                  << std::endl
+                  << "Block size:          " << configs[0].blockSize
+                  << std::endl
+                  << "Global mem unroll:   " << configs[0].globalMemUnroll
+                  << std::endl;
+        bm_model::printModelResults(configs[0],
+                                    *bm_model::simulate(configs[0]));
+        return 0;
+    }
+
+    // Compare all combinations in a single table
+    const int width = 13;
+    std::cout << std::setw(width) << "matrix" << std::setw(width) << "block"
+              << std::setw(width) << "unroll" << std::setw(width) << "time"
+              << std::setw(width) << "GFLOPS" << std::setw(width) << "roof"
+              << std::endl;
+    for (const bm_model::ModelConfiguration& config : configs) {
+        std::shared_ptr<bm_model::ModelResults> model =
+                                                bm_model::simulate(config);
+        std::cout << std::setw(width) << config.matrixSize
+                  << std::setw(width) << config.blockSize
+                  << std::setw(width) << config.globalMemUnroll
+                  << std::setw(width) << model->time
+                  << std::setw(width) << model->gflops
+                  << std::setw(width)
+                  << std::min(model->computeRoof, model->memoryRoof)
+                  << std::endl;
+    }
+    return 0;
+}
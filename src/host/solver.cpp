@@ -0,0 +1,137 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Related header files */
+#include "src/host/solver.h"
+
+/* C++ standard library headers */
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* External library headers */
+#include "CL/cl.hpp"
+
+/* Project's headers */
+#include "src/host/fpga_setup.h"
+
+namespace linpack_solver {
+
+/*
+ @copydoc linpack_solver::Solver::Solver()
+*/
+Solver::Solver(std::string kernelFileName, int platform, int device,
+               uint blockSize, uint replications) : stopped(false) {
+    std::vector<cl::Device> usedDevice =
+                        fpga_setup::selectFPGADevice(platform, device);
+    cl::Context context;
+    cl::Program program = fpga_setup::fpgaSetup(usedDevice, kernelFileName,
+                                                 &context);
+    // Only the matrix size, block size, replications and the resources
+    // are used to solve the jobs
+    config = std::shared_ptr<bm_execution::ExecutionConfiguration>(
+                new bm_execution::ExecutionConfiguration {
+                    context, usedDevice[0], program, 1, replications, 0,
+                    blockSize, bm_execution::VerificationMode::full, 0, 0,
+                    false, 0, 1, true, false, 0,
+                    std::make_shared<bm_execution::ExecutionResources>()});
+    worker = std::thread(&Solver::work, this);
+}
+
+/*
+ @copydoc linpack_solver::Solver::~Solver()
+*/
+Solver::~Solver() {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopped = true;
+    }
+    jobsAvailable.notify_one();
+    worker.join();
+}
+
+/*
+ @copydoc linpack_solver::Solver::submit()
+*/
+std::future<SolverResult>
+Solver::submit(std::vector<DATA_TYPE> matrix, std::vector<DATA_TYPE> rhs,
+               size_t n) {
+    if (n == 0 || n % config->blockSize != 0) {
+        throw std::invalid_argument("Matrix size " + std::to_string(n)
+                        + " is no multiple of the block size "
+                        + std::to_string(config->blockSize));
+    }
+    if (matrix.size() != n * n || rhs.empty() || rhs.size() % n != 0) {
+        throw std::invalid_argument("Size of the matrix or the right-hand "
+                                    "sides does not match the matrix size "
+                                    + std::to_string(n));
+    }
+    Job job{std::move(matrix), std::move(rhs), n,
+            std::promise<SolverResult>()};
+    std::future<SolverResult> result = job.result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        jobs.push_back(std::move(job));
+    }
+    jobsAvailable.notify_one();
+    return result;
+}
+
+/*
+ @copydoc linpack_solver::Solver::work()
+*/
+void
+Solver::work() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            jobsAvailable.wait(lock, [this] {
+                return stopped || !jobs.empty();
+            });
+            // Remaining jobs are finished before the worker stops
+            if (jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        // Errors of a job are passed to its future, so the worker can
+        // continue with the next job
+        try {
+            std::shared_ptr<bm_execution::ExecutionConfiguration> jobConfig(
+                        new bm_execution::ExecutionConfiguration(*config));
+            jobConfig->matrixSize = job.n;
+            bm_execution::PhaseTimes times = bm_execution::solve(jobConfig,
+                            job.matrix.data(), job.rhs.data(),
+                            job.rhs.size() / job.n);
+            job.result.set_value(SolverResult{std::move(job.rhs), times});
+        } catch (...) {
+            job.result.set_exception(std::current_exception());
+        }
+    }
+}
+
+}  // namespace linpack_solver
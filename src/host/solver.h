@@ -0,0 +1,136 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SRC_HOST_SOLVER_H_
+#define SRC_HOST_SOLVER_H_
+
+/* C++ standard library headers */
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Project's headers */
+#include "src/host/execution.h"
+
+namespace linpack_solver {
+
+/**
+Result of a job that was submitted to the solver.
+The solution contains the solutions of all right-hand sides one after the
+other.
+
+@see linpack_solver::Solver::submit()
+*/
+struct SolverResult {
+    std::vector<DATA_TYPE> solution;
+    bm_execution::PhaseTimes times;
+};
+
+/**
+Solver for linear equations that can be embedded into other applications.
+It selects and programs the FPGA once and owns the device, program and the
+device buffers that are shared by all jobs.
+The jobs are executed one after the other by a worker thread, so the
+application can continue its own work until it needs the result of a job.
+*/
+class Solver {
+ public:
+    /**
+    Select the FPGA and program it with the given kernel file
+
+    @param kernelFileName The path to the kernel file
+    @param platform The index of the platform that has to be used. If a
+                    value < 0 is given, the platform is chosen
+                    interactively on stdin.
+    @param device The index of the device that has to be used. If a
+                  value < 0 is given, the device is chosen interactively
+                  on stdin.
+    @param blockSize The block size of the kernels
+    @param replications The number of used replications of the C4 unit
+
+    @throws std::runtime_error if the device can not be selected or the
+            FPGA can not be programmed with the kernel file
+    */
+    Solver(std::string kernelFileName, int platform = 0, int device = 0,
+           uint blockSize = BLOCK_SIZE, uint replications = 1);
+
+    /**
+    Waits until all submitted jobs are finished
+    */
+    ~Solver();
+
+    Solver(const Solver&) = delete;
+    Solver& operator=(const Solver&) = delete;
+
+    /**
+    Submit a job that solves the linear equations A*X = B.
+    The call returns as soon as the job is queued. The matrix is factorized
+    once and every right-hand side is solved with the factorization.
+
+    @param matrix The matrix A of size n x n in row-major order
+    @param rhs The right-hand sides stored one after the other. Every
+               right-hand side has the size n.
+    @param n The size of the matrix. Must be a multiple of the block size.
+
+    @throws std::invalid_argument if the sizes of the matrix and the
+            right-hand sides do not match n or n is no multiple of the
+            block size
+
+    @return The future that will contain the solutions and the times of
+            the job. If the job fails, the future contains the exception,
+            e.g. a std::runtime_error for an error of the OpenCL library.
+    */
+    std::future<SolverResult>
+    submit(std::vector<DATA_TYPE> matrix, std::vector<DATA_TYPE> rhs,
+           size_t n);
+
+ private:
+    /**
+    A submitted job that is not executed yet
+    */
+    struct Job {
+        std::vector<DATA_TYPE> matrix;
+        std::vector<DATA_TYPE> rhs;
+        size_t n;
+        std::promise<SolverResult> result;
+    };
+
+    /**
+    Executes the queued jobs until the solver is destroyed
+    */
+    void work();
+
+    std::shared_ptr<bm_execution::ExecutionConfiguration> config;
+    std::deque<Job> jobs;
+    std::mutex jobsMutex;
+    std::condition_variable jobsAvailable;
+    bool stopped;
+    std::thread worker;
+};
+
+}  // namespace linpack_solver
+
+#endif  // SRC_HOST_SOLVER_H_
@@ -0,0 +1,317 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Related header files */
+#include "src/host/solver_service.h"
+
+/* C++ standard library headers */
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+
+/* External library headers */
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Project's headers */
+#include "src/host/fpga_setup.h"
+#include "src/host/linpack_functionality.h"
+
+namespace solver_service {
+
+/**
+The maximum length of a request line in characters. It is large enough for
+the longest path of a matrix file.
+*/
+static const size_t maxLineLength = 8192;
+
+/**
+Result of reading a request line from the connection
+*/
+enum class LineStatus {
+    complete,
+    closed,
+    tooLong
+};
+
+/**
+Read a single line from the connection. At most maxLineLength characters
+are read, so a client that never sends a new line can not make the service
+allocate unbounded memory.
+
+@param fd The file descriptor of the connection
+@param line The line without the new line character
+
+@return closed, if the connection was closed before a line was read and
+        tooLong, if the line has more than maxLineLength characters
+*/
+static LineStatus
+readLine(int fd, std::string* line) {
+    line->clear();
+    char c;
+    while (read(fd, &c, 1) == 1) {
+        if (c == '\n') {
+            return LineStatus::complete;
+        }
+        if (line->size() == maxLineLength) {
+            return LineStatus::tooLong;
+        }
+        *line += c;
+    }
+    return line->empty() ? LineStatus::closed : LineStatus::complete;
+}
+
+/**
+Write the given data completely to the connection
+
+@param fd The file descriptor of the connection
+@param data The data that has to be written
+@param size The size of the data in bytes
+
+@return false, if the connection was closed
+*/
+static bool
+writeAll(int fd, const void* data, size_t size) {
+    const char* current = reinterpret_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = send(fd, current, size, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        current += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+Remove the socket with the given path if it exists. Other files are not
+removed, so a wrong socket path does not delete the file of the user.
+
+@param socketPath The path of the socket
+
+@return false, if the path exists and is no socket or can not be removed
+*/
+static bool
+removeSocket(const std::string& socketPath) {
+    struct stat status;
+    if (lstat(socketPath.c_str(), &status) != 0) {
+        return true;
+    }
+    return S_ISSOCK(status.st_mode) && unlink(socketPath.c_str()) == 0;
+}
+
+/**
+Handle a single solve request and write the answer to the connection
+
+@param fd The file descriptor of the connection
+@param request The request line without the leading "solve"
+@param config The configuration that is used for the job
+@param maxMatrixSize The largest matrix size that is accepted
+@param maxRhs The largest number of right-hand sides that is accepted
+
+@return false, if the connection was closed
+*/
+static bool
+handleSolve(int fd, std::istringstream& request,
+            std::shared_ptr<bm_execution::ExecutionConfiguration> config,
+            ulong maxMatrixSize, uint maxRhs) {
+    ulong n;
+    uint nrhs;
+    std::string source;
+    if (!(request >> n >> nrhs >> source) || n == 0 || nrhs == 0) {
+        std::string answer = "error invalid request\n";
+        return writeAll(fd, answer.c_str(), answer.size());
+    }
+    if (n % config->blockSize != 0) {
+        std::string answer = "error matrix size is no multiple of the "
+                             "block size " +
+                             std::to_string(config->blockSize) + "\n";
+        return writeAll(fd, answer.c_str(), answer.size());
+    }
+    // The sizes of the matrix and the right-hand sides in bytes must not
+    // overflow, also if a large maximum is configured
+    size_t maxElements = std::numeric_limits<size_t>::max()
+                         / sizeof(DATA_TYPE);
+    if (n > maxMatrixSize || nrhs > maxRhs || n > maxElements / n
+            || nrhs > maxElements / n) {
+        std::string answer = "error matrix size or number of right-hand "
+                             "sides exceeds the maximum of " +
+                             std::to_string(maxMatrixSize) + " and " +
+                             std::to_string(maxRhs) + "\n";
+        return writeAll(fd, answer.c_str(), answer.size());
+    }
+
+    DATA_TYPE* a = nullptr;
+    DATA_TYPE* b = nullptr;
+    if (posix_memalign(reinterpret_cast<void**>(&a), 64,
+                       sizeof(DATA_TYPE)*n*n) != 0
+            || posix_memalign(reinterpret_cast<void**>(&b), 64,
+                              sizeof(DATA_TYPE)*n*nrhs) != 0) {
+        // free() ignores the buffer that was not allocated
+        free(reinterpret_cast<void *>(a));
+        std::string answer = "error not enough memory for the job\n";
+        return writeAll(fd, answer.c_str(), answer.size());
+    }
+
+    std::string error;
+    if (source == "generate") {
+        DATA_TYPE norma;
+        matgen(a, n, n, b, &norma);
+        for (uint k = 1; k < nrhs; k++) {
+            for (ulong i = 0; i < n; i++) {
+                b[k * n + i] = (k + 1) * b[i];
+            }
+        }
+    } else if (source == "file") {
+        // The path is the rest of the line, so it may contain spaces
+        std::string path;
+        std::getline(request >> std::ws, path);
+        std::ifstream file(path, std::ios::binary);
+        file.read(reinterpret_cast<char*>(a), sizeof(DATA_TYPE)*n*n);
+        file.read(reinterpret_cast<char*>(b), sizeof(DATA_TYPE)*n*nrhs);
+        if (!file) {
+            error = "could not read matrix file " + path;
+        }
+    } else {
+        error = "unknown matrix source " + source;
+    }
+
+    // Errors of the OpenCL library are sent to the client instead of
+    // stopping the service
+    bm_execution::PhaseTimes times;
+    if (error.empty()) {
+        std::shared_ptr<bm_execution::ExecutionConfiguration> jobConfig(
+                    new bm_execution::ExecutionConfiguration(*config));
+        jobConfig->matrixSize = n;
+        try {
+            times = bm_execution::solve(jobConfig, a, b, nrhs);
+        } catch (const std::exception& e) {
+            error = e.what();
+            std::cerr << "Job failed: " << error << std::endl;
+        }
+    }
+
+    bool connected;
+    if (error.empty()) {
+        double total = times.write + times.gefa + times.gesl + times.read;
+        std::cout << "Solved job with n=" << n << " and nrhs=" << nrhs
+                  << " in " << total << "s" << std::endl;
+        std::ostringstream answer;
+        answer << "ok " << times.write << " " << times.gefa << " "
+               << times.gesl << " " << times.read << " " << total << "\n";
+        connected = writeAll(fd, answer.str().c_str(), answer.str().size())
+                    && writeAll(fd, b, sizeof(DATA_TYPE)*n*nrhs);
+    } else {
+        std::string answer = "error " + error + "\n";
+        connected = writeAll(fd, answer.c_str(), answer.size());
+    }
+
+    free(reinterpret_cast<void *>(a));
+    free(reinterpret_cast<void *>(b));
+    return connected;
+}
+
+/*
+ @copydoc solver_service::run()
+*/
+void
+run(std::string socketPath,
+    std::shared_ptr<bm_execution::ExecutionConfiguration> config,
+    ulong maxMatrixSize, uint maxRhs) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << socketPath << std::endl;
+        exit(1);
+    }
+    socketPath.copy(address.sun_path, socketPath.size());
+
+    // A socket that is left from a previous service is replaced
+    if (!removeSocket(socketPath)) {
+        std::cerr << "Socket path exists and is no socket: " << socketPath
+                  << std::endl;
+        exit(1);
+    }
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0
+        || bind(server, reinterpret_cast<sockaddr*>(&address),
+                sizeof(address)) != 0
+        || listen(server, 1) != 0) {
+        std::cerr << "Could not create socket " << socketPath << std::endl;
+        exit(1);
+    }
+    std::cout << "Solver service is listening on " << socketPath
+              << std::endl;
+
+    bool shutdown = false;
+    while (!shutdown) {
+        int connection = accept(server, nullptr, nullptr);
+        if (connection < 0) {
+            continue;
+        }
+        std::string line;
+        bool connected = true;
+        while (connected && !shutdown) {
+            LineStatus status = readLine(connection, &line);
+            if (status == LineStatus::closed) {
+                break;
+            }
+            if (status == LineStatus::tooLong) {
+                // The rest of the line is not read, so the connection is
+                // closed after the answer
+                std::string answer = "error request is longer than "
+                                     + std::to_string(maxLineLength)
+                                     + " characters\n";
+                writeAll(connection, answer.c_str(), answer.size());
+                break;
+            }
+            std::istringstream request(line);
+            std::string command;
+            request >> command;
+            if (command == "solve") {
+                connected = handleSolve(connection, request, config,
+                                        maxMatrixSize, maxRhs);
+            } else if (command == "shutdown") {
+                shutdown = true;
+            } else {
+                std::string answer = "error unknown command " + command
+                                     + "\n";
+                connected = writeAll(connection, answer.c_str(),
+                                     answer.size());
+            }
+        }
+        close(connection);
+    }
+
+    close(server);
+    removeSocket(socketPath);
+    std::cout << "Solver service stopped" << std::endl;
+}
+
+}  // namespace solver_service
@@ -0,0 +1,75 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SRC_HOST_SOLVER_SERVICE_H_
+#define SRC_HOST_SOLVER_SERVICE_H_
+
+/* C++ standard library headers */
+#include <memory>
+#include <string>
+
+/* Project's headers */
+#include "src/host/execution.h"
+
+namespace solver_service {
+
+/**
+Runs a service that solves linear equations with the already programmed
+FPGA until it receives a shutdown request.
+The service listens on a local UNIX socket and handles the connections one
+after the other. Every connection can send multiple requests, each given as
+a single line of text:
+
+    solve <n> <nrhs> generate
+    solve <n> <nrhs> file <path>
+    shutdown
+
+A request line has at most 8192 characters. A longer line is answered with
+an error and the connection is closed. The path of `file` is the rest of
+the line, so it may contain spaces.
+For `generate`, the matrix is generated with the same generator as in the
+benchmark and the k-th right-hand side is chosen such that all elements of
+the solution are k+1. For `file`, the file contains the matrix of size
+n x n in row-major order followed by the nrhs right-hand sides as raw
+DATA_TYPE values.
+The answer is a line `ok <write> <gefa> <gesl> <read> <total>` containing
+the times of the phases in seconds followed by the nrhs solutions as raw
+DATA_TYPE values, or a line `error <message>` if the request is invalid,
+too large or the job failed.
+
+@param socketPath The path of the UNIX socket that is created by the service.
+                  An existing socket with this path is replaced. If the
+                  path exists and is no socket, the service is not started.
+@param config The configuration that is used for all jobs. The matrix size
+              is set by every job. The resources of the configuration are
+              shared between the jobs, so the device buffers are only
+              created again if a larger matrix is solved.
+@param maxMatrixSize The largest matrix size that is accepted
+@param maxRhs The largest number of right-hand sides that is accepted
+*/
+void
+run(std::string socketPath,
+    std::shared_ptr<bm_execution::ExecutionConfiguration> config,
+    ulong maxMatrixSize, uint maxRhs);
+
+}  // namespace solver_service
+
+#endif  // SRC_HOST_SOLVER_SERVICE_H_
@@ -0,0 +1,234 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+Tests of the host functions that do not need an FPGA. They check the CPU
+reference implementations against each other and the conversions between
+the matrix layouts of the host and the kernels.
+The program returns 0 if all tests pass.
+*/
+
+/* C++ standard library headers */
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Project's headers */
+#include "src/host/linpack_functionality.h"
+
+/**
+Number of failed checks
+*/
+static int failures = 0;
+
+/**
+Print the result of a check and count it if it failed
+
+@param passed The result of the check
+@param name The name of the check
+*/
+static void
+check(bool passed, const std::string& name) {
+    std::cout << (passed ? "PASSED " : "FAILED ") << name << std::endl;
+    if (!passed) {
+        failures++;
+    }
+}
+
+/**
+Compare the blocked CPU factorization with the unblocked one. The pivots
+have to be equal and the factors may only differ by rounding errors. The
+size is chosen such that the last panel of the blocked factorization is
+smaller than CPU_BLOCK_SIZE.
+
+@param n The size of the matrix
+*/
+static void
+testBlockedFactorization(ulong n) {
+    std::vector<DATA_TYPE> a(n * n);
+    std::vector<DATA_TYPE> a_blocked(n * n);
+    std::vector<DATA_TYPE> b(n);
+    std::vector<cl_int> ipvt(n);
+    std::vector<cl_int> ipvt_blocked(n);
+    DATA_TYPE norma;
+    matgen(a.data(), n, n, b.data(), &norma);
+    a_blocked = a;
+
+    gefa_ref(a.data(), n, n, ipvt.data());
+    gefa_ref_blocked(a_blocked.data(), n, n, ipvt_blocked.data());
+
+    double maxDiff = 0.0;
+    double maxValue = 0.0;
+    for (ulong i = 0; i < n * n; i++) {
+        maxDiff = std::max(maxDiff,
+                           std::fabs(static_cast<double>(a[i])
+                                     - a_blocked[i]));
+        maxValue = std::max(maxValue, std::fabs(static_cast<double>(a[i])));
+    }
+    std::string size = " n=" + std::to_string(n);
+    check(ipvt == ipvt_blocked, "gefa_ref_blocked pivots" + size);
+    check(maxDiff <= 1.0e-3 * maxValue, "gefa_ref_blocked factors" + size);
+}
+
+/**
+Solve multiple right-hand sides at once with the blocked solver and compare
+the solutions with the single right-hand side solver gesl_ref.
+
+@param n The size of the matrix
+@param nrhs The number of right-hand sides
+*/
+static void
+testMultipleRightHandSides(ulong n, ulong nrhs) {
+    std::vector<DATA_TYPE> a(n * n);
+    std::vector<DATA_TYPE> b(n * nrhs);
+    std::vector<cl_int> ipvt(n);
+    DATA_TYPE norma;
+    matgen(a.data(), n, n, b.data(), &norma);
+    // The k-th right-hand side is a multiple of the generated one
+    for (ulong k = 1; k < nrhs; k++) {
+        for (ulong i = 0; i < n; i++) {
+            b[k * n + i] = (k + 1) * b[i];
+        }
+    }
+    gefa_ref(a.data(), n, n, ipvt.data());
+
+    std::vector<DATA_TYPE> single(b);
+    for (ulong k = 0; k < nrhs; k++) {
+        gesl_ref(a.data(), single.data() + k * n, ipvt.data(), n, n);
+    }
+    std::vector<DATA_TYPE> a_copy(a);
+    gesl_ref_blocked(a.data(), b.data(), ipvt.data(), n, n, nrhs, n);
+
+    double maxDiff = 0.0;
+    for (ulong i = 0; i < n * nrhs; i++) {
+        maxDiff = std::max(maxDiff,
+                           std::fabs(static_cast<double>(single[i]) - b[i]));
+    }
+    std::string size = " n=" + std::to_string(n) + " nrhs="
+                       + std::to_string(nrhs);
+    // The solution of the k-th right-hand side contains only the value k+1
+    check(maxDiff <= 1.0e-3 * nrhs, "gesl_ref_blocked solutions" + size);
+    check(a == a_copy, "gesl_ref_blocked restores the factors" + size);
+}
+
+/**
+Convert a matrix to the tile layout and back. Every element has to be
+stored in the block that is used by the kernels.
+
+@param n The size of the matrix
+@param blockSize The size of the blocks
+*/
+static void
+testTileLayout(ulong n, uint blockSize) {
+    std::vector<DATA_TYPE> a(n * n);
+    for (ulong i = 0; i < n * n; i++) {
+        a[i] = static_cast<DATA_TYPE>(i);
+    }
+    std::vector<DATA_TYPE> tiles(n * n);
+    std::vector<DATA_TYPE> back(n * n);
+    convertToTileLayout(a.data(), tiles.data(), n, n, blockSize);
+    convertFromTileLayout(tiles.data(), back.data(), n, n, blockSize);
+
+    bool placed = true;
+    ulong aSize = n / blockSize;
+    for (ulong i = 0; i < n; i++) {
+        for (ulong j = 0; j < n; j++) {
+            ulong index = ((i / blockSize) * aSize + j / blockSize)
+                                * blockSize * blockSize
+                          + (i % blockSize) * blockSize + j % blockSize;
+            placed = placed && tiles[index] == a[i * n + j];
+        }
+    }
+    std::string size = " n=" + std::to_string(n) + " block="
+                       + std::to_string(blockSize);
+    check(placed, "tile layout places the blocks" + size);
+    check(back == a, "tile layout round trip" + size);
+}
+
+/**
+Distribute a matrix over the memory banks and collect it again. Every bank
+may only contain the columns of the blocks that belong to it.
+
+@param n The size of the matrix
+@param blockSize The size of the blocks
+@param bankCount The number of memory banks
+*/
+static void
+testBankLayout(ulong n, uint blockSize, uint bankCount) {
+    // Every element contains its column within the block
+    std::vector<DATA_TYPE> a(n * n);
+    for (ulong i = 0; i < n * n; i++) {
+        a[i] = static_cast<DATA_TYPE>(i % blockSize);
+    }
+    std::vector<DATA_TYPE> banks(n * n);
+    std::vector<DATA_TYPE> back(n * n);
+    convertToBankLayout(a.data(), banks.data(), n, blockSize, bankCount);
+    convertFromBankLayout(banks.data(), back.data(), n, blockSize, bankCount);
+
+    bool distributed = true;
+    ulong bankSize = n * n / bankCount;
+    for (ulong i = 0; i < n * n; i++) {
+        distributed = distributed
+                && static_cast<ulong>(banks[i]) % bankCount == i / bankSize;
+    }
+    // Also check the round trip with unique values
+    for (ulong i = 0; i < n * n; i++) {
+        a[i] = static_cast<DATA_TYPE>(i);
+    }
+    convertToBankLayout(a.data(), banks.data(), n, blockSize, bankCount);
+    convertFromBankLayout(banks.data(), back.data(), n, blockSize, bankCount);
+
+    std::string size = " n=" + std::to_string(n) + " block="
+                       + std::to_string(blockSize) + " banks="
+                       + std::to_string(bankCount) + " tiles="
+                       + std::to_string(TILE_LAYOUT);
+    check(distributed, "bank layout distributes the columns" + size);
+    check(back == a, "bank layout round trip" + size);
+}
+
+/**
+Run all tests
+*/
+int
+main(int argc, char * argv[]) {
+    testBlockedFactorization(256);
+    testBlockedFactorization(200);
+
+    testMultipleRightHandSides(256, 1);
+    testMultipleRightHandSides(256, 5);
+    testMultipleRightHandSides(200, 3);
+
+    testTileLayout(256, 32);
+    testTileLayout(96, 8);
+
+    for (uint banks : {1u, 2u, 4u}) {
+        testBankLayout(256, 32, banks);
+        testBankLayout(96, 8, banks);
+    }
+
+    std::cout << (failures == 0 ? "All tests passed"
+                                : std::to_string(failures) + " tests failed")
+              << std::endl;
+    return failures == 0 ? 0 : 1;
+}
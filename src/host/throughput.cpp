@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Related header files */
+#include "src/host/throughput.h"
+
+/* C++ standard library headers */
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+/* Project's headers */
+#include "src/host/fpga_setup.h"
+
+namespace bm_execution {
+
+/*
+ @copydoc bm_execution::scheduleJobs()
+*/
+std::shared_ptr<ThroughputResults>
+scheduleJobs(uint jobs, uint inFlight, EnqueueJobFunction enqueueJob,
+             CompleteJobFunction completeJob) {
+    typedef std::chrono::high_resolution_clock clock;
+    std::vector<std::vector<cl::Event>> slotEvents(inFlight);
+    std::vector<clock::time_point> submitTimes(inFlight);
+    std::vector<double> latencies;
+    uint submitted = 0;
+
+    auto submit = [&](uint slot) {
+        submitTimes[slot] = clock::now();
+        slotEvents[slot] = enqueueJob(slot);
+        submitted++;
+    };
+
+    auto start = clock::now();
+    for (uint slot = 0; slot < std::min(jobs, inFlight); slot++) {
+        submit(slot);
+    }
+    // The jobs of a slot are submitted in order, so the oldest job in
+    // flight always belongs to the next slot
+    for (uint job = 0; job < jobs; job++) {
+        uint slot = job % inFlight;
+        int err = cl::Event::waitForEvents(slotEvents[slot]);
+        ASSERT_CL(err);
+        if (completeJob) {
+            completeJob(slot);
+        }
+        std::chrono::duration<double> latency =
+            std::chrono::duration_cast<std::chrono::duration<double>>
+                                            (clock::now() - submitTimes[slot]);
+        latencies.push_back(latency.count());
+        if (submitted < jobs) {
+            submit(slot);
+        }
+    }
+    std::chrono::duration<double> timespan =
+        std::chrono::duration_cast<std::chrono::duration<double>>
+                                                        (clock::now() - start);
+
+    return std::shared_ptr<ThroughputResults>(
+                    new ThroughputResults{jobs, inFlight, 1, timespan.count(),
+                                          latencies, 0.0});
+}
+
+}  // namespace bm_execution
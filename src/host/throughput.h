@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2019 Marius Meyer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SRC_HOST_THROUGHPUT_H_
+#define SRC_HOST_THROUGHPUT_H_
+
+/* C++ standard library headers */
+#include <functional>
+#include <memory>
+#include <vector>
+
+/* External library headers */
+#include "CL/cl.hpp"
+
+/* Project's headers */
+#include "src/host/execution.h"
+
+namespace bm_execution {
+
+/**
+Enqueues all commands of the next job to the queue of the given slot and
+returns the events of the job. The job is completed when all events are
+completed.
+*/
+typedef std::function<std::vector<cl::Event>(uint slot)> EnqueueJobFunction;
+
+/**
+Called on the host after a job of the given slot is completed on the
+device, e.g. to finish the solve on the host.
+*/
+typedef std::function<void(uint slot)> CompleteJobFunction;
+
+/**
+Schedule the jobs of the throughput mode over the given number of slots.
+The slots are used round-robin. First, a job is submitted to every slot.
+Then the host waits for the oldest job, completes it and submits the next
+job to the same slot until all jobs are completed.
+The latency of a job is measured on the host from its submission until it
+is completed.
+
+@param jobs The total number of jobs
+@param inFlight The number of slots
+@param enqueueJob Enqueues the commands of a job to a slot
+@param completeJob Completes a job of a slot on the host. May be empty.
+
+@return The latencies of the jobs and the total time. The number of
+        matrices per job and the error rate have to be set by the caller.
+*/
+std::shared_ptr<ThroughputResults>
+scheduleJobs(uint jobs, uint inFlight, EnqueueJobFunction enqueueJob,
+             CompleteJobFunction completeJob);
+
+}  // namespace bm_execution
+
+#endif  // SRC_HOST_THROUGHPUT_H_